@@ -0,0 +1,356 @@
+#include <TGraphErrors.h>
+#include <TF1.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <regex>
+#include <sstream>
+
+#include "common.h"
+#include "dataset.h"
+#include "fitfunction.h"
+#include "gradientfit.h"
+#include "lsq.h"
+#include "options.h"
+#include "parser.h"
+#include "predict.h"
+#include "report.h"
+#include "synthetic.h"
+
+// Timings of the stages of multipar on generated rea.elts files, one line per file size and stage:
+// benchmark [--rows=1000,10000,100000,1000000] [--elements=5] [--dir=.] [--seed=1] [--threads=0]
+//           [--fit-rows=1000000] [--csv=file] [--regenerate]
+// Files are generated once as dir/synthetic_<rows>_<elements>_<seed>.elts and reused.
+// --fit-rows skips the Minuit fits above that many rows, --csv appends the lines to file for comparison between builds.
+
+struct StageResult {
+    std::string stage;
+    double seconds{0.0};
+    size_t rows{0};
+    size_t bytes{0};     // read from the file, 0 if the stage works on parsed data
+    double peakRss{0.0}; // MB
+};
+
+// Peak resident set size of the process in MB (VmHWM), 0 if /proc is not available.
+double peakRss()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.rfind("VmHWM:", 0) == 0)
+        {
+            return std::stod(line.substr(6)) / 1024.0;
+        }
+    }
+    return 0.0;
+}
+
+// Resets VmHWM to the current RSS so the peak of every stage is seen separately (Linux 4.0+).
+void resetPeakRss()
+{
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+}
+
+// Silences std::cout while alive, the parsers print every matched row.
+class QuietCout
+{
+public:
+    QuietCout() : _buf{std::cout.rdbuf(nullptr)} {}
+    ~QuietCout()
+    {
+        std::cout.rdbuf(_buf);
+    }
+private:
+    std::streambuf *_buf;
+};
+
+StageResult runStage(const std::string &stage,
+                     const size_t bytes,
+                     const std::function<size_t()> &body)
+{
+    resetPeakRss();
+    const auto start{std::chrono::steady_clock::now()};
+    size_t rows{0};
+    {
+        QuietCout quiet;
+        rows = body();
+    }
+    const std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - start};
+    return {stage, elapsed.count(), rows, bytes, peakRss()};
+}
+
+std::vector<size_t> parseSizes(const std::string &str)
+{
+    std::vector<size_t> sizes;
+    std::stringstream ss(str);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        try
+        {
+            sizes.push_back(static_cast<size_t>(std::stod(item)));
+        }
+        catch (const std::exception &)
+        {
+            throw my_error("Wrong value of --rows: " + item);
+        }
+    }
+    return sizes;
+}
+
+std::vector<StageResult> benchmarkFile(const std::string &fileName,
+                                       const std::map<std::string, ChemResult> &chem,
+                                       const unsigned int nThreads,
+                                       const size_t fitRows)
+{
+    const auto bytes{static_cast<size_t>(std::filesystem::file_size(fileName))};
+    const auto columnElement{getColumnElement(fileName)};
+    const std::regex m{"\\d+_\\d\\."};
+    std::vector<StageResult> results;
+    double sink{0.0};
+
+    results.push_back(runStage("splitLineToStrs+strToDouble", bytes, [&]()
+    {
+        std::ifstream in(fileName);
+        std::string line;
+        std::getline(in, line);
+        size_t rows{0};
+        while (std::getline(in, line))
+        {
+            const auto strs{splitLineToStrs(line)};
+            for (size_t i{1}; i < strs.size(); ++i)
+            {
+                sink += strToDouble(strs[i]);
+            }
+            ++rows;
+        }
+        return rows;
+    }));
+
+    results.push_back(runStage("splitLineToViews+columnToDouble", bytes, [&]()
+    {
+        std::ifstream in(fileName);
+        std::string line;
+        std::getline(in, line);
+        std::vector<std::string_view> strs;
+        size_t rows{0};
+        while (std::getline(in, line))
+        {
+            splitLineToViews(line, strs);
+            for (size_t i{1}; i < strs.size(); ++i)
+            {
+                sink += columnToDouble(strs, i, rows + 2);
+            }
+            ++rows;
+        }
+        return rows;
+    }));
+
+    results.push_back(runStage("getFitResults", bytes, [&]()
+    {
+        const auto data{getFitResults(fileName, columnElement, chem, m)};
+        size_t rows{0};
+        for (const auto &item : data)
+        {
+            rows += item.second.fr.size();
+        }
+        return rows;
+    }));
+
+    Dataset data;
+    results.push_back(runStage("getDataset", bytes, [&]()
+    {
+        data = getDataset(fileName, columnElement, chem, m);
+        return data.rows();
+    }));
+
+    const SampleIndex index(chem);
+    results.push_back(runStage("getDataset (name index)", bytes, [&]()
+    {
+        return getDataset(fileName, columnElement, SampleMatcher(index, { SampleKind::Grad })).rows();
+    }));
+
+    results.push_back(runStage("readTable", bytes, [&]()
+    {
+        return readTable(fileName, nThreads).rows();
+    }));
+
+    // what getFitResultsByValue used to do: rows with a reference of A and their design
+    const auto value{Data1::Value::A};
+    std::vector<size_t> rows;
+    std::vector<std::vector<double>> design;
+    std::vector<double> y;
+    std::vector<double> w;
+    const auto yErr{0.5};
+    results.push_back(runStage("getFitResultsByValue", 0, [&]()
+    {
+        rows = data.rowsWith(value);
+        design = data.design(rows);
+        y.clear();
+        for (auto row : rows)
+        {
+            y.push_back(data.reference(row, value).value());
+        }
+        w.assign(rows.size(), 1.0 / (yErr * yErr));
+        return rows.size();
+    }));
+
+    // limits of main for its 5 elements
+    std::map<size_t, ParLimits> parLimits;
+    if (data.elements.size() == 5)
+    {
+        parLimits = {
+            { 1, { -5.0, 0.0 } },
+            { 5, { 50.0, 150.0 } },
+        };
+    }
+
+    if (rows.size() <= fitRows)
+    {
+        results.push_back(runStage("TF1 fit (FitFunction_2)", 0, [&]()
+        {
+            std::vector<double> x(rows.size());
+            std::iota(x.begin(), x.end(), 0.0);
+            const std::vector<double> xErr(rows.size(), 0.01);
+            const std::vector<double> yErrs(rows.size(), yErr);
+            std::unique_ptr<TGraphErrors> gr{new TGraphErrors(static_cast<int>(x.size()), &x[0], &y[0], &xErr[0], &yErrs[0])};
+            FitFunction_2 fObj(data, rows);
+            std::unique_ptr<TF1> f{new TF1("f", fObj, x.front(), x.back(), static_cast<int>(data.elements.size() + 1))};
+            for (const auto &item : parLimits)
+            {
+                f->SetParLimits(static_cast<int>(item.first), item.second.lower, item.second.upper);
+            }
+            gr->Fit(f.get(), "RQN");
+            sink += f->GetChisquare();
+            return rows.size();
+        }));
+    }
+
+    if (rows.size() <= fitRows)
+    {
+        results.push_back(runStage("Fitter (analytic gradient)", 0, [&]()
+        {
+            sink += fitGradient(design, y, w, parLimits).chi2;
+            return rows.size();
+        }));
+    }
+
+    LinearFit fit;
+    results.push_back(runStage("fitLinear", 0, [&]()
+    {
+        fit = fitLinear(design, y, w, parLimits);
+        return rows.size();
+    }));
+
+    results.push_back(runStage("calcConv", 0, [&]()
+    {
+        const auto report{calcConv(data, predict(data, fit.par), value, fit.par)};
+        sink += report.stdAbs;
+        return data.rows();
+    }));
+
+    if (sink == 0.0)
+    {
+        std::cout << "Error: no values parsed from " << fileName << std::endl;
+    }
+    return results;
+}
+
+void printResults(const std::vector<StageResult> &results,
+                  const size_t fileRows,
+                  const size_t elements,
+                  std::ostream &out,
+                  const bool csv)
+{
+    for (const auto &r : results)
+    {
+        const auto rowsPerSecond{r.seconds > 0.0 ? static_cast<double>(r.rows) / r.seconds : 0.0};
+        const auto mbPerSecond{r.seconds > 0.0 ? static_cast<double>(r.bytes) / 1e6 / r.seconds : 0.0};
+        if (csv)
+        {
+            out << fileRows << "," << elements << "," << r.stage << "," << r.seconds << "," << r.rows << ","
+                << rowsPerSecond << "," << mbPerSecond << "," << r.peakRss << "\n";
+            continue;
+        }
+        out << std::setw(9) << fileRows << std::setw(4) << elements << "  " << std::left << std::setw(32) << r.stage << std::right
+            << std::setw(11) << std::fixed << std::setprecision(4) << r.seconds
+            << std::setw(14) << std::setprecision(0) << rowsPerSecond
+            << std::setw(9) << std::setprecision(1);
+        if (r.bytes > 0)
+        {
+            out << mbPerSecond;
+        }
+        else
+        {
+            out << "-";
+        }
+        out << std::setw(10) << r.peakRss << std::defaultfloat << std::setprecision(6) << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        Options options(argc, argv);
+        const auto sizes{parseSizes(options.get("rows", "1000,10000,100000,1000000"))};
+        SyntheticSpec spec;
+        spec.elements = options.getUInt("elements", 5);
+        spec.seed = options.getUInt("seed", 1);
+        const auto dir{options.get("dir", ".")};
+        const auto nThreads{options.getUInt("threads", 0)};
+        const auto fitRows{static_cast<size_t>(options.getDouble("fit-rows", 1e6))};
+
+        std::ofstream csv;
+        if (options.has("csv"))
+        {
+            const auto csvName{options.get("csv")};
+            const auto exists{std::filesystem::exists(csvName)};
+            csv.open(csvName, std::ios::app);
+            if (!csv)
+            {
+                throw my_error("Can't write file " + csvName);
+            }
+            if (!exists)
+            {
+                csv << "file_rows,elements,stage,seconds,rows,rows_per_s,mb_per_s,peak_rss_mb\n";
+            }
+        }
+
+        std::cout << "     rows  el  stage                               seconds        rows/s     MB/s  peak MB" << std::endl;
+        for (auto size : sizes)
+        {
+            spec.rows = size;
+            const auto fileName{dir + "/synthetic_" + std::to_string(spec.rows) + "_" + std::to_string(spec.elements) + "_"
+                                + std::to_string(spec.seed) + ".elts"};
+            if (options.has("regenerate") || !std::filesystem::exists(fileName))
+            {
+                const auto start{std::chrono::steady_clock::now()};
+                writeSyntheticElts(fileName, spec);
+                const std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - start};
+                std::cout << "generated " << fileName << " in " << elapsed.count() << " s" << std::endl;
+            }
+            const auto results{benchmarkFile(fileName, syntheticChem(spec), nThreads, fitRows)};
+            printResults(results, spec.rows, spec.elements, std::cout, false);
+            if (csv.is_open())
+            {
+                printResults(results, spec.rows, spec.elements, csv, true);
+            }
+        }
+    }
+    catch (const std::exception &err)
+    {
+        std::cout << "Error: " << err.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,12 @@
+# Stage timings on generated rea.elts files, see benchmark.cpp.
+TEMPLATE = app
+TARGET = benchmark
+
+include(multipar_core.pri)
+
+SOURCES += \
+        benchmark.cpp \
+        synthetic.cpp
+
+HEADERS += \
+        synthetic.h
@@ -0,0 +1,172 @@
+#include "bootstrap.h"
+#include "instrument.h"
+#include "predict.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+
+// linearly interpolated quantile of sorted values
+double quantile(const std::vector<double> &sorted, const double q)
+{
+    const auto pos{q * static_cast<double>(sorted.size() - 1)};
+    const auto i{static_cast<size_t>(pos)};
+    if (i + 1 >= sorted.size())
+    {
+        return sorted.back();
+    }
+    return sorted[i] + (pos - static_cast<double>(i)) * (sorted[i + 1] - sorted[i]);
+}
+
+}
+
+void BootstrapResult::print(const Dataset &predictData, const Data1::Value value) const
+{
+    std::cout << "bootstrap: " << replicates << " replicates, " << failed << " failed, "
+              << 100.0 * level << "% intervals" << std::endl;
+    for (size_t i{0}; i < par.size(); ++i)
+    {
+        std::cout << "p" << i << ": " << par[i].median << " [" << par[i].lower << ", " << par[i].upper << "]" << std::endl;
+    }
+    for (size_t row{0}; row < prediction.size(); ++row)
+    {
+        auto v{predictData.reference(row, value)};
+        std::cout << predictData.samples[predictData.rowSample[row]] << ": "
+                  << prediction[row].median << " [" << prediction[row].lower << ", " << prediction[row].upper << "]";
+        if (v.has_value())
+        {
+            std::cout << " chem " << v.value();
+        }
+        std::cout << std::endl;
+    }
+}
+
+BootstrapResult bootstrap(const Dataset &data,
+                          const Data1::Value value,
+                          const size_t nReplicates,
+                          const std::map<size_t, ParLimits> &limits,
+                          const double yErr,
+                          const Dataset &predictData,
+                          const double level,
+                          const std::uint64_t seed,
+                          const unsigned int nThreads)
+{
+    StageTimer timer("bootstrap");
+    if (predictData.elements != data.elements)
+    {
+        throw my_error("bootstrap: prediction data has a different element set");
+    }
+    const auto rows{data.rowsWith(value)};
+    const auto nPar{data.elements.size() + 1};
+    const auto w{1.0 / (yErr * yErr)};
+
+    std::vector<CompressedRows> samples;
+    for (size_t first{0}; first < rows.size();)
+    {
+        auto last{first};
+        std::vector<double> y;
+        while (last < rows.size() && data.rowSample[rows[last]] == data.rowSample[rows[first]])
+        {
+            y.push_back(data.reference(rows[last], value).value());
+            ++last;
+        }
+        std::vector<size_t> sampleRows(rows.begin() + static_cast<long>(first), rows.begin() + static_cast<long>(last));
+        samples.push_back(compressRows(data.design(sampleRows), y, std::vector<double>(y.size(), w)));
+        first = last;
+    }
+    if (samples.size() < 2)
+    {
+        throw my_error("bootstrap: at least two samples are needed");
+    }
+
+    const auto nPredict{predictData.rows()};
+    std::vector<double> par(nReplicates * nPar);
+    std::vector<double> prediction(nReplicates * nPredict);
+    std::vector<char> ok(nReplicates, 0);
+    std::vector<const double *> predictColumns;
+    for (const auto &column : predictData.values)
+    {
+        predictColumns.push_back(column.data());
+    }
+
+    ThreadPool pool(defaultThreads(nThreads) - 1);
+    pool.parallelFor(nReplicates, [&](size_t r){
+        std::seed_seq seq{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32),
+                          static_cast<std::uint32_t>(r), static_cast<std::uint32_t>(r >> 32)};
+        std::mt19937_64 rng(seq);
+        std::uniform_int_distribution<size_t> pick(0, samples.size() - 1);
+        std::vector<size_t> count(samples.size(), 0);
+        for (size_t i{0}; i < samples.size(); ++i)
+        {
+            ++count[pick(rng)];
+        }
+
+        std::vector<std::vector<double>> columns(nPar);
+        std::vector<double> y;
+        for (size_t s{0}; s < samples.size(); ++s)
+        {
+            if (count[s] == 0)
+            {
+                continue;
+            }
+            // a sample drawn c times is its rows with weight c
+            const auto scale{std::sqrt(static_cast<double>(count[s]))};
+            for (size_t j{0}; j < nPar; ++j)
+            {
+                for (auto v : samples[s].columns[j])
+                {
+                    columns[j].push_back(scale * v);
+                }
+            }
+            for (auto v : samples[s].y)
+            {
+                y.push_back(scale * v);
+            }
+        }
+        LinearFit fit;
+        try
+        {
+            fit = fitLinear(columns, y, std::vector<double>(y.size(), 1.0), limits);
+        }
+        catch (const my_error &)
+        {
+            return;
+        }
+        std::copy(fit.par.begin(), fit.par.end(), par.begin() + static_cast<long>(r * nPar));
+        predictBatch(fit.par, predictColumns, nPredict, prediction.data() + r * nPredict);
+        ok[r] = 1;
+    });
+
+    BootstrapResult result;
+    result.replicates = nReplicates;
+    result.level = level;
+    result.failed = static_cast<size_t>(std::count(ok.begin(), ok.end(), 0));
+    if (result.failed == nReplicates)
+    {
+        throw my_error("bootstrap: no replicate could be fitted");
+    }
+    auto interval = [&ok, nReplicates, level](const std::vector<double> &v, const size_t stride, const size_t offset){
+        std::vector<double> sorted;
+        for (size_t r{0}; r < nReplicates; ++r)
+        {
+            if (ok[r])
+            {
+                sorted.push_back(v[r * stride + offset]);
+            }
+        }
+        std::sort(sorted.begin(), sorted.end());
+        return Interval{ quantile(sorted, 0.5 * (1.0 - level)), quantile(sorted, 0.5), quantile(sorted, 0.5 * (1.0 + level)) };
+    };
+    for (size_t j{0}; j < nPar; ++j)
+    {
+        result.par.push_back(interval(par, nPar, j));
+    }
+    for (size_t row{0}; row < nPredict; ++row)
+    {
+        result.prediction.push_back(interval(prediction, nPredict, row));
+    }
+    return result;
+}
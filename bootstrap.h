@@ -0,0 +1,38 @@
+#ifndef BOOTSTRAP_H
+#define BOOTSTRAP_H
+
+#include "dataset.h"
+#include "lsq.h"
+
+#include <cstdint>
+
+struct Interval {
+    double lower;
+    double median;
+    double upper;
+};
+
+struct BootstrapResult {
+    size_t replicates{0};
+    size_t failed{0};
+    double level{0.95};
+    std::vector<Interval> par;        // per parameter, intercept last
+    std::vector<Interval> prediction; // per row of the prediction dataset
+    void print(const Dataset &predictData, const Data1::Value value) const;
+};
+
+// Percentile bootstrap of the calibration of value: every replicate draws the samples of data
+// with replacement (all rows of a drawn sample go together) and refits with fitLinear and limits.
+// Each sample is compressed by QR once, so a replicate fit only sees nPar rows per drawn sample.
+// Replicate i uses its own generator seeded from (seed, i), so results do not depend on nThreads.
+BootstrapResult bootstrap(const Dataset &data,
+                          const Data1::Value value,
+                          const size_t nReplicates,
+                          const std::map<size_t, ParLimits> &limits,
+                          const double yErr,
+                          const Dataset &predictData,
+                          const double level = 0.95,
+                          const std::uint64_t seed = 1,
+                          const unsigned int nThreads = 0);
+
+#endif // BOOTSTRAP_H
@@ -0,0 +1,68 @@
+#ifndef COMMON_H
+#define COMMON_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <optional>
+#include <exception>
+
+class my_error: public std::exception
+{
+public:
+    my_error(const std::string& message) : _message{message}
+    {}
+    const char* what() const noexcept override
+    {
+        return _message.c_str();
+    }
+private:
+    std::string _message;
+};
+
+
+struct FitResult {
+    std::string e;
+    double value;
+    double valueError;
+    void print() const {
+        std::cout << e << " " << value << "\u00B1" << valueError << " ";
+    }
+};
+
+struct ChemResult {
+    enum class Value {
+        A,
+        W
+    };
+    std::optional<double> a;
+    std::optional<double> w;
+    void print() const {
+        auto a{this->a.has_value() ?  this->a.value() : -1};
+        auto w{this->w.has_value() ?  this->w.value() : -1};
+        std::cout << a << " " << w;
+    }
+};
+
+struct Data1 {
+    enum class Value {
+        A,
+        W
+    };
+    ChemResult chem;
+    std::vector<std::vector<FitResult>> fr;
+    void print() const {
+        auto a{this->chem.a.has_value() ?  this->chem.a.value() : -1};
+        auto w{this->chem.w.has_value() ?  this->chem.w.value() : -1};
+        std::cout << a << " " << w << " ";
+        for (const auto& eItem : this->fr)
+        {
+            for (const auto& eItemItem : eItem)
+            {
+                eItemItem.print();
+            }
+        }
+    }
+};
+
+#endif // COMMON_H
@@ -0,0 +1,433 @@
+#include "dataset.h"
+#include "instrument.h"
+#include "mappedfile.h"
+#include "parser.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <numeric>
+
+std::optional<double> getReference(const ChemResult &chem, const Data1::Value value)
+{
+    switch (value) {
+    case Data1::Value::A:
+        return chem.a;
+    case Data1::Value::W:
+        return chem.w;
+    }
+    return std::nullopt;
+}
+
+size_t Dataset::elementIndex(const std::string &element) const
+{
+    auto it{std::find(elements.begin(), elements.end(), element)};
+    if (it == elements.end())
+    {
+        throw my_error("No element \"" + element + "\" in dataset");
+    }
+    return static_cast<size_t>(it - elements.begin());
+}
+
+std::vector<size_t> Dataset::rowsWith(const Data1::Value value) const
+{
+    std::vector<size_t> r;
+    for (size_t i{0}; i < rows(); ++i)
+    {
+        if (reference(i, value).has_value())
+        {
+            r.push_back(i);
+        }
+    }
+    return r;
+}
+
+size_t Dataset::indexInSample(const size_t row) const
+{
+    auto first{std::lower_bound(rowSample.begin(), rowSample.begin() + static_cast<long>(row), rowSample[row])};
+    return row - static_cast<size_t>(first - rowSample.begin());
+}
+
+std::vector<std::vector<double>> Dataset::design(const std::vector<size_t> &rows) const
+{
+    std::vector<std::vector<double>> columns(elements.size() + 1);
+    for (size_t e{0}; e < elements.size(); ++e)
+    {
+        columns[e].reserve(rows.size());
+        for (auto r : rows)
+        {
+            columns[e].push_back(values[e][r]);
+        }
+    }
+    columns.back().assign(rows.size(), 1.0);
+    return columns;
+}
+
+void Dataset::print() const
+{
+    for (size_t r{0}; r < rows(); ++r)
+    {
+        std::cout << samples[rowSample[r]] << " ";
+        chem[rowSample[r]].print();
+        for (size_t e{0}; e < elements.size(); ++e)
+        {
+            std::cout << " " << elements[e] << " " << values[e][r] << "\u00B1" << errors[e][r];
+        }
+        std::cout << std::endl;
+    }
+}
+
+DatasetBuilder::DatasetBuilder(const std::map<int, std::string> &columnElement)
+{
+    for (const auto &item : columnElement)
+    {
+        _elements.push_back(item.second);
+    }
+}
+
+void DatasetBuilder::add(const std::string &sample, const ChemResult &chem, const std::vector<double> &values, const std::uint32_t source)
+{
+    auto &s{_samples[sample]};
+    s.chem = chem;
+    s.values.insert(s.values.end(), values.begin(), values.end());
+    s.sources.push_back(source);
+}
+
+Dataset DatasetBuilder::build()
+{
+    Dataset d;
+    d.elements = _elements;
+    const auto nElements{_elements.size()};
+    size_t nRows{0};
+    for (const auto &item : _samples)
+    {
+        nRows += item.second.values.size() / (2 * nElements);
+    }
+    d.values.assign(nElements, {});
+    d.errors.assign(nElements, {});
+    for (size_t e{0}; e < nElements; ++e)
+    {
+        d.values[e].reserve(nRows);
+        d.errors[e].reserve(nRows);
+    }
+    d.rowSample.reserve(nRows);
+    d.rowSource.reserve(nRows);
+    for (const auto &item : _samples)
+    {
+        const auto sampleIdx{d.samples.size()};
+        d.samples.push_back(item.first);
+        d.chem.push_back(item.second.chem);
+        const auto &v{item.second.values};
+        for (size_t i{0}, r{0}; i + 2 * nElements <= v.size(); i += 2 * nElements, ++r)
+        {
+            for (size_t e{0}; e < nElements; ++e)
+            {
+                d.values[e].push_back(v[i + 2 * e]);
+                d.errors[e].push_back(v[i + 2 * e + 1]);
+            }
+            d.rowSample.push_back(sampleIdx);
+            d.rowSource.push_back(item.second.sources[r]);
+        }
+    }
+    _samples.clear();
+    return d;
+}
+
+NormalEquations normalEquations(const Dataset &data,
+                                const std::vector<size_t> &rows,
+                                const Data1::Value value,
+                                const double w)
+{
+    const auto nElements{data.elements.size()};
+    const auto p{nElements + 1};
+    // gathered columns, the intercept column is implicit
+    std::vector<std::vector<double>> x(nElements, std::vector<double>(rows.size()));
+    std::vector<double> y(rows.size());
+    for (size_t i{0}; i < rows.size(); ++i)
+    {
+        for (size_t e{0}; e < nElements; ++e)
+        {
+            x[e][i] = data.values[e][rows[i]];
+        }
+        y[i] = data.reference(rows[i], value).value();
+    }
+    auto dot = [&rows](const std::vector<double> &a, const std::vector<double> &b){
+        auto s{0.0};
+        for (size_t i{0}; i < rows.size(); ++i)
+        {
+            s += a[i] * b[i];
+        }
+        return s;
+    };
+    auto sum = [](const std::vector<double> &a){
+        return std::accumulate(a.begin(), a.end(), 0.0);
+    };
+    NormalEquations ne(p);
+    for (size_t i{0}; i < nElements; ++i)
+    {
+        for (size_t j{0}; j <= i; ++j)
+        {
+            ne.xtx[i * p + j] = ne.xtx[j * p + i] = w * dot(x[i], x[j]);
+        }
+        ne.xtx[i * p + nElements] = ne.xtx[nElements * p + i] = w * sum(x[i]);
+        ne.xty[i] = w * dot(x[i], y);
+    }
+    ne.xtx[nElements * p + nElements] = w * static_cast<double>(rows.size());
+    ne.xty[nElements] = w * sum(y);
+    ne.yty = w * dot(y, y);
+    ne.sumW = w * static_cast<double>(rows.size());
+    ne.n = rows.size();
+    return ne;
+}
+
+Dataset makeDataset(const std::map<std::string, Data1> &data)
+{
+    Dataset d;
+    for (const auto &item : data)
+    {
+        if (d.elements.empty() && !item.second.fr.empty())
+        {
+            for (const auto &fR : item.second.fr.front())
+            {
+                d.elements.push_back(fR.e);
+            }
+            d.values.assign(d.elements.size(), {});
+            d.errors.assign(d.elements.size(), {});
+        }
+        const auto sampleIdx{d.samples.size()};
+        d.samples.push_back(item.first);
+        d.chem.push_back(item.second.chem);
+        for (const auto &row : item.second.fr)
+        {
+            if (row.size() != d.elements.size())
+            {
+                throw my_error("makeDataset: rows of \"" + item.first + "\" have a different element set");
+            }
+            for (size_t e{0}; e < row.size(); ++e)
+            {
+                d.values[e].push_back(row[e].value);
+                d.errors[e].push_back(row[e].valueError);
+            }
+            d.rowSample.push_back(sampleIdx);
+        }
+    }
+    d.rowSource.assign(d.rowSample.size(), 0);
+    return d;
+}
+
+Dataset getDataset(const std::string &fileName,
+                   const std::map<int, std::string> &columnElement,
+                   const std::map<std::string, ChemResult> &chem,
+                   const std::regex &pattern,
+                   const RowFilter &filter)
+{
+    return getDataset(fileName, columnElement, SampleMatcher(chem, pattern), filter);
+}
+
+Dataset getDataset(const std::string &fileName,
+                   const std::map<int, std::string> &columnElement,
+                   const SampleMatcher &matcher,
+                   const RowFilter &filter)
+{
+    DatasetBuilder builder(columnElement);
+    parseFile(fileName, columnElement, matcher,
+              [&builder](size_t, ChemIterator it, std::string_view, const std::vector<double> &values){
+        builder.add(it->first, it->second, values);
+    }, filter);
+    auto data{builder.build()};
+    data.sources = { fileName };
+    return data;
+}
+
+std::vector<Dataset> getDatasetsMapped(const std::string &fileName,
+                                       const std::map<int, std::string> &columnElement,
+                                       const std::map<std::string, ChemResult> &chem,
+                                       const std::vector<std::regex> &patterns,
+                                       const unsigned int nThreads,
+                                       const RowFilter &filter)
+{
+    std::vector<SampleMatcher> matchers;
+    for (const auto &pattern : patterns)
+    {
+        matchers.emplace_back(chem, pattern);
+    }
+    return getDatasetsMapped(fileName, columnElement, matchers, nThreads, filter);
+}
+
+std::vector<Dataset> getDatasetsMapped(const std::string &fileName,
+                                       const std::map<int, std::string> &columnElement,
+                                       const std::vector<SampleMatcher> &matchers,
+                                       const unsigned int nThreads,
+                                       const RowFilter &filter)
+{
+    std::vector<DatasetBuilder> builders(matchers.size(), DatasetBuilder(columnElement));
+    parseMapped(fileName, columnElement, matchers, nThreads,
+                [&builders](size_t p, ChemIterator it, std::string_view, const std::vector<double> &values){
+        builders[p].add(it->first, it->second, values);
+    }, filter);
+    std::vector<Dataset> datasets;
+    for (auto &builder : builders)
+    {
+        datasets.push_back(builder.build());
+        datasets.back().sources = { fileName };
+    }
+    return datasets;
+}
+
+std::vector<std::string_view> Table::nameParts(const size_t row) const
+{
+    std::vector<std::string_view> r;
+    std::string_view name{names[row]};
+    for (auto i{partBegin[row]}; i < partBegin[row + 1]; ++i)
+    {
+        r.push_back(name.substr(parts[i].pos, parts[i].size));
+    }
+    return r;
+}
+
+Table readTable(const std::string &fileName, const unsigned int nThreads, const RowFilter &filter)
+{
+    StageTimer timer("parse.table");
+    const auto columnElement{getColumnElement(fileName)};
+    const auto fileFilter{filter.forFile(fileName)};
+    const auto firstExtra{columnElement.empty() ? size_t{1} : static_cast<size_t>(columnElement.rbegin()->first) + 2};
+    struct ChunkRows {
+        std::vector<std::string> names;
+        std::vector<double> values;
+        std::vector<std::vector<double>> extra;
+        std::vector<std::string> errors;
+    };
+
+    MappedFile file(fileName);
+    const auto threads{defaultThreads(nThreads)};
+    ThreadPool pool(threads - 1);
+    const auto chunks{splitTextToChunks(file.data(), chunkCount(file.size(), threads))};
+    std::vector<ChunkRows> chunkRows(chunks.size());
+    scanChunks(chunks, pool, [&](size_t i, size_t lineNumber, const std::vector<std::string_view> &strs){
+        if (strs.front() == "fileName" || !fileFilter.accept(strs))
+        {
+            return;
+        }
+        thread_local std::vector<double> values;
+        std::vector<double> extra;
+        try
+        {
+            getValuesFromLine(strs, columnElement, lineNumber, values);
+            for (auto column{firstExtra}; column < strs.size(); ++column)
+            {
+                extra.push_back(columnToDouble(strs, column, lineNumber));
+            }
+        }
+        catch (const my_error& err)
+        {
+            chunkRows[i].errors.push_back(err.what());
+            return;
+        }
+        chunkRows[i].names.emplace_back(strs.front());
+        chunkRows[i].values.insert(chunkRows[i].values.end(), values.begin(), values.end());
+        chunkRows[i].extra.push_back(std::move(extra));
+    });
+
+    Table table;
+    for (const auto &item : columnElement)
+    {
+        table.elements.push_back(item.second);
+    }
+    const auto nElements{table.elements.size()};
+    size_t nExtra{0};
+    for (const auto &c : chunkRows)
+    {
+        for (const auto &e : c.extra)
+        {
+            nExtra = std::max(nExtra, e.size());
+        }
+    }
+    table.values.assign(nElements, {});
+    table.errors.assign(nElements, {});
+    table.extra.assign(nExtra, {});
+    table.partBegin.push_back(0);
+    std::vector<std::string_view> parts;
+    for (auto &c : chunkRows)
+    {
+        for (const auto &error : c.errors)
+        {
+            std::cout << "Error: " << error << std::endl;
+        }
+        for (size_t i{0}; i + 2 * nElements <= c.values.size(); i += 2 * nElements)
+        {
+            for (size_t e{0}; e < nElements; ++e)
+            {
+                table.values[e].push_back(c.values[i + 2 * e]);
+                table.errors[e].push_back(c.values[i + 2 * e + 1]);
+            }
+        }
+        for (const auto &e : c.extra)
+        {
+            for (size_t k{0}; k < nExtra; ++k)
+            {
+                table.extra[k].push_back(k < e.size() ? e[k] : std::numeric_limits<double>::quiet_NaN());
+            }
+        }
+        for (const auto &name : c.names)
+        {
+            splitSampleName(name, parts);
+            for (auto part : parts)
+            {
+                table.parts.push_back({ static_cast<std::uint32_t>(part.data() - name.data()), static_cast<std::uint32_t>(part.size()) });
+            }
+            table.partBegin.push_back(table.parts.size());
+        }
+        std::move(c.names.begin(), c.names.end(), std::back_inserter(table.names));
+    }
+    table.sources = { fileName };
+    table.rowSource.assign(table.names.size(), 0);
+    return table;
+}
+
+Dataset selectDataset(const Table &table,
+                      const std::vector<std::string> &elements,
+                      const std::map<std::string, ChemResult> &chem,
+                      const std::regex &pattern)
+{
+    return selectDataset(table, elements, SampleMatcher(chem, pattern));
+}
+
+Dataset selectDataset(const Table &table,
+                      const std::vector<std::string> &elements,
+                      const SampleMatcher &matcher)
+{
+    const auto &chem{matcher.chem()};
+    std::vector<size_t> columns;
+    std::map<int, std::string> columnElement;
+    for (const auto &element : elements)
+    {
+        auto it{std::find(table.elements.begin(), table.elements.end(), element)};
+        if (it == table.elements.end())
+        {
+            throw my_error("No element \"" + element + "\" in table");
+        }
+        columnElement[static_cast<int>(columns.size())] = element;
+        columns.push_back(static_cast<size_t>(it - table.elements.begin()));
+    }
+
+    DatasetBuilder builder(columnElement);
+    std::vector<double> values;
+    for (size_t row{0}; row < table.rows(); ++row)
+    {
+        auto it{matcher.match(table.names[row])};
+        if (it == chem.end())
+        {
+            continue;
+        }
+        values.clear();
+        for (auto c : columns)
+        {
+            values.push_back(table.values[c][row]);
+            values.push_back(table.errors[c][row]);
+        }
+        builder.add(it->first, it->second, values, table.rowSource[row]);
+    }
+    auto data{builder.build()};
+    data.sources = table.sources;
+    return data;
+}
@@ -0,0 +1,144 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include "common.h"
+#include "lsq.h"
+#include "rowfilter.h"
+#include "samplekey.h"
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+std::optional<double> getReference(const ChemResult &chem, const Data1::Value value);
+
+// Column store of parsed rows. Rows are grouped by sample in the order of the sample keys
+// (as std::map<std::string, Data1> iterates) and keep the file order inside a sample.
+struct Dataset {
+    std::vector<std::string> elements;       // element dictionary, index is the column
+    std::vector<std::vector<double>> values; // values[element][row]
+    std::vector<std::vector<double>> errors; // errors[element][row]
+    std::vector<std::string> samples;        // sample keys
+    std::vector<ChemResult> chem;            // reference values per sample
+    std::vector<size_t> rowSample;           // row -> sample index
+    std::vector<std::string> sources;        // files the rows were read from, empty for makeDataset
+    std::vector<std::uint32_t> rowSource;    // row -> index into sources
+
+    size_t rows() const
+    {
+        return rowSample.size();
+    }
+    size_t elementIndex(const std::string &element) const;
+    std::optional<double> reference(const size_t row, const Data1::Value value) const
+    {
+        return getReference(chem[rowSample[row]], value);
+    }
+    // Rows with a reference value for value, in dataset order.
+    std::vector<size_t> rowsWith(const Data1::Value value) const;
+    // Index of row inside its sample.
+    size_t indexInSample(const size_t row) const;
+    // Element columns restricted to rows plus a trailing column of ones for the intercept.
+    std::vector<std::vector<double>> design(const std::vector<size_t> &rows) const;
+    void print() const;
+};
+
+// Collects matched rows sample by sample and lays them out as a Dataset.
+class DatasetBuilder
+{
+public:
+    explicit DatasetBuilder(const std::map<int, std::string> &columnElement);
+    // values as produced by getValuesFromLine: value, error, value, error, ...
+    // source is the index of the file of the row in Dataset::sources.
+    void add(const std::string &sample, const ChemResult &chem, const std::vector<double> &values, const std::uint32_t source = 0);
+    Dataset build();
+private:
+    struct Sample {
+        ChemResult chem;
+        std::vector<double> values;
+        std::vector<std::uint32_t> sources;
+    };
+    std::vector<std::string> _elements;
+    std::map<std::string, Sample> _samples;
+};
+
+// Normal equations of the calibration of value over rows: all elements and the intercept as the last parameter,
+// every row with weight w.
+NormalEquations normalEquations(const Dataset &data,
+                                const std::vector<size_t> &rows,
+                                const Data1::Value value,
+                                const double w);
+
+Dataset makeDataset(const std::map<std::string, Data1> &data);
+
+Dataset getDataset(const std::string &fileName,
+                   const std::map<int, std::string> &columnElement,
+                   const std::map<std::string, ChemResult> &chem,
+                   const std::regex &pattern,
+                   const RowFilter &filter = {});
+
+// getDataset of the rows selected by matcher.
+Dataset getDataset(const std::string &fileName,
+                   const std::map<int, std::string> &columnElement,
+                   const SampleMatcher &matcher,
+                   const RowFilter &filter = {});
+
+// One Dataset per pattern from a single parallel pass over the mapped file, see getFitResultsMapped.
+std::vector<Dataset> getDatasetsMapped(const std::string &fileName,
+                                       const std::map<int, std::string> &columnElement,
+                                       const std::map<std::string, ChemResult> &chem,
+                                       const std::vector<std::regex> &patterns,
+                                       const unsigned int nThreads = 0,
+                                       const RowFilter &filter = {});
+
+// getDatasetsMapped with one Dataset per matcher.
+std::vector<Dataset> getDatasetsMapped(const std::string &fileName,
+                                       const std::map<int, std::string> &columnElement,
+                                       const std::vector<SampleMatcher> &matchers,
+                                       const unsigned int nThreads = 0,
+                                       const RowFilter &filter = {});
+
+// All rows of a file with every element column of its header, in file order.
+// Parsed once, it is the source of any number of Datasets (see selectDataset).
+struct Table {
+    struct NamePart {
+        std::uint32_t pos;
+        std::uint32_t size;
+    };
+
+    std::vector<std::string> elements;
+    std::vector<std::vector<double>> values; // values[element][row]
+    std::vector<std::vector<double>> errors; // errors[element][row]
+    std::vector<std::vector<double>> extra;  // extra[column][row], numeric columns after the last error, NaN if missing
+    std::vector<std::string> names;          // first column of every row
+    std::vector<NamePart> parts;             // components of the names as split by splitSampleName
+    std::vector<std::uint64_t> partBegin;    // rows + 1 offsets into parts
+    std::vector<std::string> sources;        // files the rows were read from
+    std::vector<std::uint32_t> rowSource;    // row -> index into sources
+
+    size_t rows() const
+    {
+        return names.size();
+    }
+    std::vector<std::string_view> nameParts(const size_t row) const;
+};
+
+// Reads fileName with nThreads workers (0 - hardware concurrency), rows that fail to parse are reported and skipped,
+// rows filter does not accept are not stored.
+Table readTable(const std::string &fileName, const unsigned int nThreads = 0, const RowFilter &filter = {});
+
+// Rows of table matching chem and pattern with the columns of elements, the same Dataset getDataset
+// gives for these elements. The rows keep their sources.
+Dataset selectDataset(const Table &table,
+                      const std::vector<std::string> &elements,
+                      const std::map<std::string, ChemResult> &chem,
+                      const std::regex &pattern);
+
+Dataset selectDataset(const Table &table,
+                      const std::vector<std::string> &elements,
+                      const SampleMatcher &matcher);
+
+#endif // DATASET_H
@@ -0,0 +1,38 @@
+#ifndef FITFUNCTION_H
+#define FITFUNCTION_H
+
+#include "dataset.h"
+#include "instrument.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// TF1 functor of the linear calibration: x is the index of a point in rows,
+// par are the element coefficients followed by the intercept.
+class FitFunction_2
+{
+public:
+    FitFunction_2(const Dataset &d, std::vector<size_t> rows) : _d{&d}, _rows{std::move(rows)} {}
+
+    double operator() (double *x, double *par)
+    {
+        countEvent(Counter::FitFunctionCalls);
+        double arg{x[0]};
+        auto idx{static_cast<size_t>(std::clamp(static_cast<long>(std::round(arg)), 0l, static_cast<long>(_rows.size() - 1)))};
+        const auto row{_rows[idx]};
+        const auto nPar{_d->elements.size()};
+        double val{0.0};
+        for (size_t i{0}; i < nPar; ++i)
+        {
+            val += par[i] * _d->values[i][row];
+        }
+        val += par[nPar];
+        return val;
+    }
+private:
+    const Dataset *_d;
+    std::vector<size_t> _rows;
+};
+
+#endif // FITFUNCTION_H
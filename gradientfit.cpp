@@ -0,0 +1,216 @@
+#include "gradientfit.h"
+#include "common.h"
+#include "predict.h"
+
+#include <Fit/Fitter.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const size_t blockRows{4096};
+
+// Four partial sums keep the additions of consecutive rows independent.
+double dot(const double *a, const double *b, const size_t n)
+{
+    double s0{0.0};
+    double s1{0.0};
+    double s2{0.0};
+    double s3{0.0};
+    size_t i{0};
+    for (; i + 4 <= n; i += 4)
+    {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; ++i)
+    {
+        s0 += a[i] * b[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+}
+
+LinearChi2::LinearChi2(const std::vector<std::vector<double>> &columns,
+                       const std::vector<double> &y,
+                       const std::vector<double> &w)
+{
+    if (columns.empty() || y.size() != w.size())
+    {
+        throw my_error("LinearChi2: no columns or y and w of different size");
+    }
+    auto rows{std::make_shared<Rows>()};
+    rows->columns.assign(columns.begin(), columns.end() - 1);
+    rows->y = y;
+    rows->w = w;
+    for (const auto &column : rows->columns)
+    {
+        if (column.size() != y.size())
+        {
+            throw my_error("LinearChi2: columns and y of different size");
+        }
+    }
+    _rows = std::move(rows);
+}
+
+ROOT::Math::IMultiGenFunction *LinearChi2::Clone() const
+{
+    return new LinearChi2(*this);
+}
+
+unsigned int LinearChi2::NDim() const
+{
+    return static_cast<unsigned int>(_rows->columns.size() + 1);
+}
+
+void LinearChi2::Gradient(const double *par, double *grad) const
+{
+    evaluate(par, grad);
+}
+
+void LinearChi2::FdF(const double *par, double &f, double *grad) const
+{
+    f = evaluate(par, grad);
+}
+
+double LinearChi2::DoEval(const double *par) const
+{
+    return evaluate(par, nullptr);
+}
+
+double LinearChi2::DoDerivative(const double *par, unsigned int i) const
+{
+    std::vector<double> grad(NDim());
+    evaluate(par, grad.data());
+    return grad[i];
+}
+
+double LinearChi2::evaluate(const double *par, double *grad) const
+{
+    const auto nElements{_rows->columns.size()};
+    const auto n{_rows->y.size()};
+    const std::vector<double> p(par, par + nElements + 1);
+    if (grad != nullptr)
+    {
+        std::fill(grad, grad + nElements + 1, 0.0);
+    }
+    std::vector<const double *> columns(nElements);
+    std::vector<double> buffer(std::min(blockRows, n));
+    auto chi2{0.0};
+    for (size_t begin{0}; begin < n; begin += blockRows)
+    {
+        const auto len{std::min(blockRows, n - begin)};
+        for (size_t e{0}; e < nElements; ++e)
+        {
+            columns[e] = _rows->columns[e].data() + begin;
+        }
+        predictBatch(p, columns, len, buffer.data());
+        // the buffer turns from predictions into weighted residuals w * (y - prediction)
+        const auto *y{_rows->y.data() + begin};
+        const auto *w{_rows->w.data() + begin};
+        for (size_t r{0}; r < len; ++r)
+        {
+            const auto res{y[r] - buffer[r]};
+            buffer[r] = w[r] * res;
+            chi2 += buffer[r] * res;
+        }
+        if (grad == nullptr)
+        {
+            continue;
+        }
+        for (size_t e{0}; e < nElements; ++e)
+        {
+            grad[e] -= 2.0 * dot(buffer.data(), columns[e], len);
+        }
+        auto sum{0.0};
+        for (size_t r{0}; r < len; ++r)
+        {
+            sum += buffer[r];
+        }
+        grad[nElements] -= 2.0 * sum;
+    }
+    return chi2;
+}
+
+LinearFit fitGradient(const std::vector<std::vector<double>> &columns,
+                      const std::vector<double> &y,
+                      const std::vector<double> &w,
+                      const std::map<size_t, ParLimits> &limits)
+{
+    const LinearChi2 chi2(columns, y, w);
+    std::vector<double> start(columns.size(), 0.0);
+    for (const auto &item : limits)
+    {
+        if (item.first < start.size())
+        {
+            start[item.first] = std::clamp(0.0, item.second.lower, item.second.upper);
+        }
+    }
+    return fitGradient(chi2, limits, start);
+}
+
+LinearFit fitGradient(const LinearChi2 &chi2,
+                      const std::map<size_t, ParLimits> &limits,
+                      const std::vector<double> &start,
+                      const std::string &minimizer)
+{
+    const auto nPar{static_cast<size_t>(chi2.NDim())};
+    if (start.size() != nPar)
+    {
+        throw my_error("fitGradient: " + std::to_string(start.size()) + " start values for " + std::to_string(nPar) + " parameters");
+    }
+    for (const auto &item : limits)
+    {
+        if (item.first >= nPar || item.second.lower > item.second.upper)
+        {
+            throw my_error("fitGradient: bad limits for parameter " + std::to_string(item.first));
+        }
+    }
+
+    ROOT::Fit::Fitter fitter;
+    fitter.Config().SetMinimizer(minimizer.c_str(), "Migrad");
+    fitter.Config().MinimizerOptions().SetPrintLevel(0);
+    // FitFCN keeps the parameter settings when it is not given parameter values
+    fitter.Config().SetParamsSettings(static_cast<unsigned int>(nPar), start.data());
+    for (size_t i{0}; i < nPar; ++i)
+    {
+        fitter.Config().ParSettings(static_cast<unsigned int>(i)).SetName("p" + std::to_string(i));
+        fitter.Config().ParSettings(static_cast<unsigned int>(i)).SetStepSize(0.1);
+    }
+    for (const auto &item : limits)
+    {
+        fitter.Config().ParSettings(static_cast<unsigned int>(item.first)).SetLimits(item.second.lower, item.second.upper);
+    }
+    if (!fitter.FitFCN(chi2))
+    {
+        throw my_error("fitGradient: Minuit failed, status " + std::to_string(fitter.Result().Status()));
+    }
+
+    const auto &result{fitter.Result()};
+    LinearFit fit;
+    fit.par = result.Parameters();
+    fit.parErr = result.Errors();
+    fit.cov.resize(nPar * nPar);
+    for (size_t i{0}; i < nPar; ++i)
+    {
+        for (size_t j{0}; j < nPar; ++j)
+        {
+            fit.cov[i * nPar + j] = result.CovMatrix(static_cast<unsigned int>(i), static_cast<unsigned int>(j));
+        }
+    }
+    fit.atLimit.assign(nPar, false);
+    for (const auto &item : limits)
+    {
+        const auto tolerance{1e-9 * std::max(1.0, item.second.upper - item.second.lower)};
+        const auto v{fit.par[item.first]};
+        fit.atLimit[item.first] = v - item.second.lower <= tolerance || item.second.upper - v <= tolerance;
+    }
+    fit.chi2 = result.MinFcnValue();
+    fit.ndf = static_cast<int>(chi2.rows()) - static_cast<int>(nPar);
+    fit.iterations = static_cast<int>(result.NCalls());
+    return fit;
+}
@@ -0,0 +1,63 @@
+#ifndef GRADIENTFIT_H
+#define GRADIENTFIT_H
+
+#include "lsq.h"
+
+#include <Math/IFunction.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// chi2 = sum_r w[r] * (y[r] - par.back() - sum_e par[e] * columns[e][r])^2 of the linear calibration
+// with its analytic gradient for ROOT::Fit::Fitter. Value and gradient come from one pass over the rows
+// in blocks, the predictions of a block by predictBatch. Clones share the rows.
+class LinearChi2 : public ROOT::Math::IMultiGradFunction
+{
+public:
+    // columns as given by Dataset::design: the element columns and the trailing column of ones.
+    LinearChi2(const std::vector<std::vector<double>> &columns,
+               const std::vector<double> &y,
+               const std::vector<double> &w);
+
+    ROOT::Math::IMultiGenFunction *Clone() const override;
+    unsigned int NDim() const override;
+    void Gradient(const double *par, double *grad) const override;
+    void FdF(const double *par, double &f, double *grad) const override;
+    size_t rows() const
+    {
+        return _rows->y.size();
+    }
+private:
+    struct Rows {
+        std::vector<std::vector<double>> columns; // element columns only
+        std::vector<double> y;
+        std::vector<double> w;
+    };
+
+    double DoEval(const double *par) const override;
+    double DoDerivative(const double *par, unsigned int i) const override;
+    // chi2 of par, the gradient is written to grad unless it is null
+    double evaluate(const double *par, double *grad) const;
+
+    std::shared_ptr<const Rows> _rows;
+};
+
+// Migrad fit of the calibration through ROOT::Fit::Fitter with the exact gradient of LinearChi2:
+// the minimum TGraphErrors::Fit(f, "R") finds through FitFunction_2, without the 2 * nPar calls of the
+// numerical derivatives per step. Starts like TF1 from zero parameters moved inside their limits,
+// limits as TF1::SetParLimits. iterations of the result is the number of chi2 evaluations.
+LinearFit fitGradient(const std::vector<std::vector<double>> &columns,
+                      const std::vector<double> &y,
+                      const std::vector<double> &w,
+                      const std::map<size_t, ParLimits> &limits = {});
+
+// The same fit of chi2 from start (one value per parameter, inside the limits) with the given ROOT minimizer.
+// Every call has its own Fitter, with "Minuit2" calls may run on several threads at once.
+LinearFit fitGradient(const LinearChi2 &chi2,
+                      const std::map<size_t, ParLimits> &limits,
+                      const std::vector<double> &start,
+                      const std::string &minimizer = "Minuit");
+
+#endif // GRADIENTFIT_H
@@ -0,0 +1,131 @@
+#include "groupstats.h"
+
+#include <cmath>
+#include <limits>
+#include <regex>
+
+Grouping groupSamples(const std::vector<std::string> &samples, const std::vector<std::string> &patterns)
+{
+    Grouping grouping;
+    grouping.names = patterns;
+    grouping.names.push_back("other");
+    std::vector<std::regex> regexes;
+    for (const auto &pattern : patterns)
+    {
+        try
+        {
+            regexes.emplace_back(pattern);
+        }
+        catch (const std::regex_error &err)
+        {
+            throw my_error("Wrong group pattern \"" + pattern + "\": " + err.what());
+        }
+    }
+    grouping.sampleGroup.reserve(samples.size());
+    for (const auto &sample : samples)
+    {
+        auto group{static_cast<std::uint32_t>(grouping.other())};
+        for (size_t g{0}; g < regexes.size(); ++g)
+        {
+            if (std::regex_search(sample, regexes[g]))
+            {
+                group = static_cast<std::uint32_t>(g);
+                break;
+            }
+        }
+        grouping.sampleGroup.push_back(group);
+    }
+    return grouping;
+}
+
+GroupAccumulator::GroupAccumulator(const std::vector<std::string> &groups, const std::vector<Data1::Value> &targets)
+    : _groups{groups}, _targets{targets}, _sums(groups.size() * targets.size())
+{
+}
+
+GroupSummary GroupAccumulator::summarize(const std::string &group, const size_t target, const Sums &s) const
+{
+    GroupSummary summary{ group, _targets[target], s.n, 0.0, 0.0, std::numeric_limits<double>::quiet_NaN() };
+    if (s.n > 0)
+    {
+        const auto n{static_cast<double>(s.n)};
+        summary.mean = s.predicted / n;
+        summary.bias = s.diff / n;
+        summary.rmse = std::sqrt(s.diff2 / n);
+    }
+    return summary;
+}
+
+GroupSummary GroupAccumulator::summary(const size_t group, const size_t target) const
+{
+    return summarize(_groups[group], target, _sums[group * _targets.size() + target]);
+}
+
+GroupSummary GroupAccumulator::total(const size_t target) const
+{
+    Sums all;
+    for (size_t g{0}; g < _groups.size(); ++g)
+    {
+        const auto &s{_sums[g * _targets.size() + target]};
+        all.n += s.n;
+        all.predicted += s.predicted;
+        all.diff += s.diff;
+        all.diff2 += s.diff2;
+    }
+    return summarize("all", target, all);
+}
+
+std::vector<GroupSummary> GroupAccumulator::summaries() const
+{
+    std::vector<GroupSummary> r;
+    for (size_t g{0}; g < _groups.size(); ++g)
+    {
+        for (size_t t{0}; t < _targets.size(); ++t)
+        {
+            r.push_back(summary(g, t));
+        }
+    }
+    return r;
+}
+
+GroupAccumulator accumulateGroups(const Dataset &data,
+                                  const std::vector<size_t> &rows,
+                                  const Grouping &grouping,
+                                  const std::vector<Data1::Value> &targets,
+                                  const std::vector<std::vector<double>> &predicted)
+{
+    if (predicted.size() != targets.size())
+    {
+        throw my_error("accumulateGroups: one prediction per target is expected");
+    }
+    GroupAccumulator accumulator(grouping.names, targets);
+    for (auto row : rows)
+    {
+        const auto group{grouping.sampleGroup[data.rowSample[row]]};
+        const auto &chem{data.chem[data.rowSample[row]]};
+        for (size_t t{0}; t < targets.size(); ++t)
+        {
+            const auto reference{getReference(chem, targets[t])};
+            if (reference.has_value())
+            {
+                accumulator.add(group, t, predicted[t][row], reference.value());
+            }
+        }
+    }
+    return accumulator;
+}
+
+void printGroupStats(const GroupAccumulator &accumulator)
+{
+    std::cout << "group target n mean bias rmse" << std::endl;
+    auto summaries{accumulator.summaries()};
+    for (size_t t{0}; t < accumulator.targets(); ++t)
+    {
+        summaries.push_back(accumulator.total(t));
+    }
+    for (const auto &s : summaries)
+    {
+        std::cout << s.group << " " << (s.target == Data1::Value::A ? "A" : "W") << " " << s.n << " "
+                  << s.mean << " " << s.bias << " " << s.rmse << std::endl;
+    }
+}
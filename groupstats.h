@@ -0,0 +1,86 @@
+#ifndef GROUPSTATS_H
+#define GROUPSTATS_H
+
+#include "common.h"
+#include "dataset.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Group of every sample, resolved once from regex patterns searched in the sample names: the first
+// matching pattern is the group, samples matching none are in the last group "other".
+// Rows find their group through their sample, with no string search per row.
+struct Grouping {
+    std::vector<std::string> names;          // the patterns, then "other"
+    std::vector<std::uint32_t> sampleGroup;  // sample -> index into names
+
+    size_t other() const
+    {
+        return names.size() - 1;
+    }
+};
+
+Grouping groupSamples(const std::vector<std::string> &samples, const std::vector<std::string> &patterns);
+
+// Statistics of prediction - reference of one group and target.
+struct GroupSummary {
+    std::string group;
+    Data1::Value target{Data1::Value::A};
+    size_t n{0};
+    double mean{0.0}; // mean prediction
+    double bias{0.0}; // mean of prediction - reference
+    double rmse{0.0}; // root mean square of prediction - reference, NaN for an empty group
+};
+
+// Sums per group x target, filled by one streaming pass over the rows.
+class GroupAccumulator
+{
+public:
+    GroupAccumulator(const std::vector<std::string> &groups, const std::vector<Data1::Value> &targets);
+
+    void add(const size_t group, const size_t target, const double predicted, const double reference)
+    {
+        auto &s{_sums[group * _targets.size() + target]};
+        const auto d{predicted - reference};
+        ++s.n;
+        s.predicted += predicted;
+        s.diff += d;
+        s.diff2 += d * d;
+    }
+    GroupSummary summary(const size_t group, const size_t target) const;
+    // All groups of target together.
+    GroupSummary total(const size_t target) const;
+    // Every group of every target, group-major.
+    std::vector<GroupSummary> summaries() const;
+    size_t targets() const
+    {
+        return _targets.size();
+    }
+private:
+    struct Sums {
+        size_t n{0};
+        double predicted{0.0};
+        double diff{0.0};
+        double diff2{0.0};
+    };
+
+    GroupSummary summarize(const std::string &group, const size_t target, const Sums &s) const;
+
+    std::vector<std::string> _groups;
+    std::vector<Data1::Value> _targets;
+    std::vector<Sums> _sums;
+};
+
+// One pass over rows of data: predicted[t] (indexed by row of data) of targets[t] against the references,
+// a row without a reference of a target is left out of that target.
+GroupAccumulator accumulateGroups(const Dataset &data,
+                                  const std::vector<size_t> &rows,
+                                  const Grouping &grouping,
+                                  const std::vector<Data1::Value> &targets,
+                                  const std::vector<std::vector<double>> &predicted);
+
+// Prints the summaries of accumulator as a group x target table, the totals of the targets last.
+void printGroupStats(const GroupAccumulator &accumulator);
+
+#endif // GROUPSTATS_H
@@ -0,0 +1,257 @@
+#include "influence.h"
+#include "instrument.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// rows with 1 - h below this are fitted exactly, the remaining rows say nothing about them
+const double exactFitTolerance{1e-10};
+
+double resolve(const double threshold, const double conventional)
+{
+    return threshold > 0.0 ? threshold : conventional;
+}
+
+}
+
+std::vector<size_t> Influence::keptRows() const
+{
+    std::vector<size_t> kept;
+    for (const auto &r : rows)
+    {
+        if (!samples[r.sample].flagged)
+        {
+            kept.push_back(r.row);
+        }
+    }
+    return kept;
+}
+
+void Influence::print(const Dataset &data) const
+{
+    std::cout << "influence: n = " << rows.size() << " free parameters = " << nPar << " s = " << s << std::endl;
+    std::cout << "row limits: cook " << rowThresholds.cook << " dfbetas " << rowThresholds.dfbetas
+              << " studentized " << rowThresholds.studentized << std::endl;
+    std::cout << "sample limits: cook " << sampleThresholds.cook << " dfbetas " << sampleThresholds.dfbetas << std::endl;
+    std::cout << "sample n leverage cook max_dfbetas" << std::endl;
+    for (const auto &si : samples)
+    {
+        std::cout << (si.flagged ? "* " : "  ") << data.samples[si.sample] << " " << si.n << " " << si.leverage
+                  << " " << si.cook << " " << si.maxDfbetas << std::endl;
+    }
+    std::cout << "flagged rows: row residual leverage studentized cook max_dfbetas" << std::endl;
+    for (const auto &r : rows)
+    {
+        if (r.flagged)
+        {
+            std::cout << "  " << data.samples[data.rowSample[r.row]] << "_" << data.indexInSample(r.row) << " "
+                      << r.residual << " " << r.leverage << " " << r.studentized << " " << r.cook << " "
+                      << r.maxDfbetas << std::endl;
+        }
+    }
+}
+
+Influence analyzeInfluence(const Dataset &data,
+                           const std::vector<size_t> &rows,
+                           const Data1::Value value,
+                           const std::map<size_t, ParLimits> &limits,
+                           const double yErr,
+                           const InfluenceThresholds &thresholds,
+                           const unsigned int nThreads)
+{
+    StageTimer timer("influence");
+    Influence result;
+    std::vector<double> y;
+    for (auto row : rows)
+    {
+        y.push_back(data.reference(row, value).value());
+    }
+    const auto w{1.0 / (yErr * yErr)};
+    const auto sqrtW{std::sqrt(w)};
+    result.fit = fitLinear(data.design(rows), y, std::vector<double>(rows.size(), w), limits);
+
+    // C is (X^T W X)^-1 of the free parameters and zero for the fixed ones,
+    // so h = w x^T C x and the deletion formulas only move the free parameters
+    const auto &cov{result.fit.cov};
+    const auto nPar{result.fit.par.size()};
+    const auto nElements{data.elements.size()};
+    std::vector<size_t> free;
+    for (size_t j{0}; j < nPar; ++j)
+    {
+        if (cov[j * nPar + j] > 0.0)
+        {
+            free.push_back(j);
+        }
+    }
+    result.nPar = free.size();
+    const auto q{free.size()};
+    const auto n{rows.size()};
+    if (n <= result.nPar + 1)
+    {
+        throw my_error("analyzeInfluence: " + std::to_string(n) + " rows are not enough for "
+                       + std::to_string(result.nPar) + " free parameters");
+    }
+    const auto dof{static_cast<double>(n - result.nPar)};
+    const auto s2{result.fit.chi2 / dof};
+    result.s = std::sqrt(s2);
+    const auto p{static_cast<double>(result.nPar)};
+
+    // rows by sample, in the order of rows
+    result.rows.resize(n);
+    std::vector<std::vector<size_t>> sampleRows;
+    std::vector<size_t> sampleSlot(data.samples.size(), data.samples.size());
+    for (size_t i{0}; i < n; ++i)
+    {
+        const auto sample{data.rowSample[rows[i]]};
+        if (sampleSlot[sample] == data.samples.size())
+        {
+            sampleSlot[sample] = result.samples.size();
+            result.samples.emplace_back();
+            result.samples.back().sample = sample;
+            sampleRows.emplace_back();
+        }
+        result.rows[i].row = rows[i];
+        result.rows[i].sample = sampleSlot[sample];
+        sampleRows[sampleSlot[sample]].push_back(i);
+    }
+
+    result.rowThresholds = {
+        resolve(thresholds.cook, 4.0 / static_cast<double>(n)),
+        resolve(thresholds.dfbetas, 2.0 / std::sqrt(static_cast<double>(n))),
+        thresholds.studentized
+    };
+    const auto nSamples{static_cast<double>(result.samples.size())};
+    result.sampleThresholds = {
+        resolve(thresholds.cook, 4.0 / nSamples),
+        resolve(thresholds.dfbetas, 2.0 / std::sqrt(nSamples)),
+        thresholds.studentized
+    };
+
+    // X^T W X of the free parameters, downdated by every sample
+    const auto a{normalEquations(data, rows, value, w).subset(free)};
+
+    const auto inf{std::numeric_limits<double>::infinity()};
+    const auto threads{std::min<unsigned int>(defaultThreads(nThreads), static_cast<unsigned int>(result.samples.size()))};
+    ThreadPool pool(threads - 1);
+    pool.parallelFor(result.samples.size(), [&](size_t g){
+        const auto &members{sampleRows[g]};
+        const auto m{members.size()};
+        // x and C x of the rows of the sample
+        std::vector<std::vector<double>> x(m, std::vector<double>(nPar, 1.0));
+        std::vector<std::vector<double>> cx(m, std::vector<double>(nPar, 0.0));
+        std::vector<double> r(m); // weighted residuals
+        for (size_t k{0}; k < m; ++k)
+        {
+            const auto row{rows[members[k]]};
+            for (size_t e{0}; e < nElements; ++e)
+            {
+                x[k][e] = data.values[e][row];
+            }
+            auto prediction{0.0};
+            for (size_t j{0}; j < nPar; ++j)
+            {
+                prediction += result.fit.par[j] * x[k][j];
+                for (size_t l{0}; l < nPar; ++l)
+                {
+                    cx[k][j] += cov[j * nPar + l] * x[k][l];
+                }
+            }
+            result.rows[members[k]].residual = y[members[k]] - prediction;
+            r[k] = sqrtW * result.rows[members[k]].residual;
+        }
+
+        // single rows
+        for (size_t k{0}; k < m; ++k)
+        {
+            auto &ri{result.rows[members[k]]};
+            auto h{0.0};
+            for (size_t j{0}; j < nPar; ++j)
+            {
+                h += w * x[k][j] * cx[k][j];
+            }
+            ri.leverage = h;
+            const auto oneMinusH{1.0 - h};
+            if (oneMinusH <= exactFitTolerance)
+            {
+                ri.studentized = 0.0;
+                ri.cook = inf;
+                ri.maxDfbetas = inf;
+            }
+            else
+            {
+                const auto s2i{std::max(0.0, (dof * s2 - r[k] * r[k] / oneMinusH) / (dof - 1.0))};
+                ri.studentized = r[k] / std::sqrt(s2i * oneMinusH);
+                ri.cook = r[k] * r[k] * h / (p * s2 * oneMinusH * oneMinusH);
+                for (size_t j{0}; j < nPar; ++j)
+                {
+                    if (cov[j * nPar + j] > 0.0)
+                    {
+                        const auto shift{cx[k][j] * sqrtW * r[k] / oneMinusH};
+                        ri.maxDfbetas = std::max(ri.maxDfbetas, std::abs(shift) / std::sqrt(s2i * cov[j * nPar + j]));
+                    }
+                }
+            }
+            ri.flagged = ri.cook > result.rowThresholds.cook || ri.maxDfbetas > result.rowThresholds.dfbetas
+                         || std::abs(ri.studentized) > result.rowThresholds.studentized;
+        }
+
+        // the whole sample: b - b(G) = (A - A_G)^-1 g with A = X^T W X and A_G = X_G^T W X_G of the free
+        // parameters and g = X_G^T W e_G, a p x p downdate whatever the number of rows of the sample
+        auto &si{result.samples[g]};
+        si.n = m;
+        si.dfbetas.assign(nPar, 0.0);
+        auto downdate{a.xtx};
+        std::vector<double> gradient(q, 0.0);
+        auto rr{0.0};
+        for (size_t k{0}; k < m; ++k)
+        {
+            si.leverage += result.rows[members[k]].leverage;
+            rr += r[k] * r[k];
+            for (size_t i{0}; i < q; ++i)
+            {
+                const auto wx{w * x[k][free[i]]};
+                gradient[i] += wx * result.rows[members[k]].residual;
+                for (size_t j{0}; j < q; ++j)
+                {
+                    downdate[i * q + j] -= wx * x[k][free[j]];
+                }
+            }
+        }
+        auto shift{gradient};
+        if (m >= dof - 1.0 || !choleskyDecompose(downdate, q))
+        {
+            si.cook = inf;
+            si.maxDfbetas = inf;
+            si.dfbetas.assign(nPar, inf);
+        }
+        else
+        {
+            choleskySolve(downdate, q, shift);
+            // D_G = (b - b(G))^T A (b - b(G)) / (p s^2), and by Woodbury r_G^T (I - H_GG)^-1 r_G = r_G^T r_G + g^T (b - b(G))
+            auto dad{0.0};
+            auto gd{0.0};
+            for (size_t i{0}; i < q; ++i)
+            {
+                for (size_t j{0}; j < q; ++j)
+                {
+                    dad += shift[i] * a.xtx[i * q + j] * shift[j];
+                }
+                gd += gradient[i] * shift[i];
+            }
+            si.cook = dad / (p * s2);
+            const auto s2g{std::max(0.0, (dof * s2 - rr - gd) / (dof - static_cast<double>(m)))};
+            for (size_t i{0}; i < q; ++i)
+            {
+                const auto j{free[i]};
+                si.dfbetas[j] = shift[i] / std::sqrt(s2g * cov[j * nPar + j]);
+                si.maxDfbetas = std::max(si.maxDfbetas, std::abs(si.dfbetas[j]));
+            }
+        }
+        si.flagged = si.cook > result.sampleThresholds.cook || si.maxDfbetas > result.sampleThresholds.dfbetas;
+    });
+    return result;
+}
@@ -0,0 +1,63 @@
+#ifndef INFLUENCE_H
+#define INFLUENCE_H
+
+#include "dataset.h"
+#include "lsq.h"
+
+// Limits above which a row or a sample is flagged, 0 - the conventional limit:
+// Cook's distance 4 / n, |DFBETAS| 2 / sqrt(n) with n the rows (the samples for sample deletion).
+struct InfluenceThresholds {
+    double cook{0.0};
+    double dfbetas{0.0};
+    double studentized{3.0}; // |externally studentized residual| of a row
+};
+
+struct RowInfluence {
+    size_t row{0};
+    size_t sample{0};        // index into Influence::samples
+    double residual{0.0};    // reference - prediction
+    double leverage{0.0};    // diagonal of the hat matrix
+    double studentized{0.0}; // externally studentized residual
+    double cook{0.0};
+    double maxDfbetas{0.0};  // largest |DFBETAS| over the parameters
+    bool flagged{false};
+};
+
+// Deletion of all rows of a sample at once, so replicates can't mask each other.
+struct SampleInfluence {
+    size_t sample{0}; // sample of the dataset
+    size_t n{0};
+    double leverage{0.0}; // trace of the hat matrix block of the sample
+    double cook{0.0};
+    double maxDfbetas{0.0};
+    std::vector<double> dfbetas; // per parameter, intercept last
+    bool flagged{false};         // over a sample limit
+};
+
+struct Influence {
+    LinearFit fit;
+    size_t nPar{0}; // free parameters of the fit
+    double s{0.0};  // residual scale, sqrt(chi2 / (n - nPar))
+    InfluenceThresholds rowThresholds;
+    InfluenceThresholds sampleThresholds;
+    std::vector<RowInfluence> rows;
+    std::vector<SampleInfluence> samples;
+
+    // rows of the samples not flagged, in the order of rows
+    std::vector<size_t> keptRows() const;
+    void print(const Dataset &data) const;
+};
+
+// Leverage, studentized residuals, Cook's distance and DFBETAS of every row and of every sample deleted
+// as a whole for the calibration of value, fitted like fitLinear with limits and a common yErr.
+// Everything follows from that one fit, no refit: a deleted row needs its leverage, a deleted sample
+// the cross-product of its rows (O(m p^2) for m rows). Parameters sitting on a limit stay fixed.
+Influence analyzeInfluence(const Dataset &data,
+                           const std::vector<size_t> &rows,
+                           const Data1::Value value,
+                           const std::map<size_t, ParLimits> &limits,
+                           const double yErr,
+                           const InfluenceThresholds &thresholds = {},
+                           const unsigned int nThreads = 0);
+
+#endif // INFLUENCE_H
@@ -0,0 +1,141 @@
+#include "ingest.h"
+#include "instrument.h"
+#include "parser.h"
+#include "tablecache.h"
+#include "threadpool.h"
+
+#include <glob.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+std::vector<std::string> headerElements(const std::string &fileName)
+{
+    std::vector<std::string> elements;
+    for (const auto &item : getColumnElement(fileName))
+    {
+        elements.push_back(item.second);
+    }
+    return elements;
+}
+
+// Appends the rows of part to table, element columns taken by name.
+void appendTable(Table &table, Table &part, const std::uint32_t source)
+{
+    const auto nRows{table.rows()};
+    for (size_t e{0}; e < table.elements.size(); ++e)
+    {
+        const auto it{std::find(part.elements.begin(), part.elements.end(), table.elements[e])};
+        const auto column{static_cast<size_t>(it - part.elements.begin())};
+        table.values[e].insert(table.values[e].end(), part.values[column].begin(), part.values[column].end());
+        table.errors[e].insert(table.errors[e].end(), part.errors[column].begin(), part.errors[column].end());
+    }
+    const auto nan{std::numeric_limits<double>::quiet_NaN()};
+    if (part.extra.size() > table.extra.size())
+    {
+        table.extra.resize(part.extra.size(), std::vector<double>(nRows, nan));
+    }
+    for (size_t k{0}; k < table.extra.size(); ++k)
+    {
+        if (k < part.extra.size())
+        {
+            table.extra[k].insert(table.extra[k].end(), part.extra[k].begin(), part.extra[k].end());
+        }
+        else
+        {
+            table.extra[k].resize(nRows + part.rows(), nan);
+        }
+    }
+    std::move(part.names.begin(), part.names.end(), std::back_inserter(table.names));
+    table.parts.insert(table.parts.end(), part.parts.begin(), part.parts.end());
+    const auto offset{table.partBegin.back()};
+    for (size_t row{1}; row < part.partBegin.size(); ++row)
+    {
+        table.partBegin.push_back(offset + part.partBegin[row]);
+    }
+    table.rowSource.resize(table.rowSource.size() + part.rows(), source);
+}
+
+}
+
+std::vector<std::string> expandFiles(const std::vector<std::string> &patterns)
+{
+    std::vector<std::string> files;
+    for (const auto &pattern : patterns)
+    {
+        glob_t matches;
+        const auto status{::glob(pattern.c_str(), 0, nullptr, &matches)};
+        if (status == GLOB_NOMATCH)
+        {
+            globfree(&matches);
+            throw my_error("No files match \"" + pattern + "\"");
+        }
+        if (status != 0)
+        {
+            globfree(&matches);
+            throw my_error("Can't expand \"" + pattern + "\"");
+        }
+        // glob sorts the matches
+        for (size_t i{0}; i < matches.gl_pathc; ++i)
+        {
+            files.emplace_back(matches.gl_pathv[i]);
+        }
+        globfree(&matches);
+    }
+    return files;
+}
+
+Table readTables(const std::vector<std::string> &fileNames,
+                 const unsigned int nThreads,
+                 const bool cached,
+                 const RowFilter &filter)
+{
+    if (fileNames.empty())
+    {
+        throw my_error("readTables: no files");
+    }
+    if (cached && !filter.empty())
+    {
+        throw my_error("readTables: a filter can't be applied to cached tables");
+    }
+    // headers first, so an incompatible file fails before anything is parsed
+    std::vector<std::vector<std::string>> elements;
+    for (const auto &fileName : fileNames)
+    {
+        elements.push_back(headerElements(fileName));
+        auto sorted{elements.back()};
+        auto expected{elements.front()};
+        std::sort(sorted.begin(), sorted.end());
+        std::sort(expected.begin(), expected.end());
+        if (sorted != expected)
+        {
+            throw my_error("Header of \"" + fileName + "\" lists other elements than \"" + fileNames.front() + "\"");
+        }
+    }
+
+    StageTimer timer("ingest.files");
+    const auto threads{defaultThreads(nThreads)};
+    // files in parallel, the threads left over split the files themselves
+    const auto fileThreads{std::max(1u, threads / static_cast<unsigned int>(fileNames.size()))};
+    std::vector<Table> parts(fileNames.size());
+    ThreadPool pool(std::min<unsigned int>(threads, static_cast<unsigned int>(fileNames.size())) - 1);
+    pool.parallelFor(fileNames.size(), [&](size_t i){
+        parts[i] = cached ? readTableCached(fileNames[i], elements[i], fileThreads)
+                          : readTable(fileNames[i], fileThreads, filter);
+    });
+
+    Table table;
+    table.elements = parts.front().elements;
+    table.values.assign(table.elements.size(), {});
+    table.errors.assign(table.elements.size(), {});
+    table.partBegin.push_back(0);
+    table.sources = fileNames;
+    for (size_t i{0}; i < parts.size(); ++i)
+    {
+        appendTable(table, parts[i], static_cast<std::uint32_t>(i));
+        parts[i] = Table{};
+    }
+    return table;
+}
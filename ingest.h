@@ -0,0 +1,23 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include "dataset.h"
+
+#include <string>
+#include <vector>
+
+// Files matching the glob patterns, sorted within a pattern, in the order of the patterns.
+// A pattern without wildcards names a file, throws my_error if a pattern matches nothing.
+std::vector<std::string> expandFiles(const std::vector<std::string> &patterns);
+
+// Reads fileNames concurrently with nThreads workers (0 - hardware concurrency) and merges them
+// into one Table in the order of fileNames: sources are fileNames, rowSource tags every row with its file.
+// The headers must list the same elements, in any order, otherwise throws my_error naming the file.
+// With cached every file goes through readTableCached, so adding a file to a set parses that file only.
+// The caches hold whole files, so filter can't be combined with cached.
+Table readTables(const std::vector<std::string> &fileNames,
+                 const unsigned int nThreads = 0,
+                 const bool cached = false,
+                 const RowFilter &filter = {});
+
+#endif // INGEST_H
@@ -0,0 +1,176 @@
+#include "instrument.h"
+#include "common.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+namespace {
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<ProfileStage> stages;
+    std::array<std::uint64_t, counterCount> counters{};
+};
+
+// Never destroyed, threads may exit after the static destructors ran.
+Registry &registry()
+{
+    static auto *r{new Registry};
+    return *r;
+}
+
+}
+
+const char *counterName(const Counter counter)
+{
+    switch (counter)
+    {
+    case Counter::LinesRead:
+        return "lines_read";
+    case Counter::LinesMatched:
+        return "lines_matched";
+    case Counter::RowsFiltered:
+        return "rows_filtered";
+    case Counter::RegexEvaluations:
+        return "regex_evaluations";
+    case Counter::FitFunctionCalls:
+        return "fit_function_calls";
+    case Counter::FitIterations:
+        return "fit_iterations";
+    case Counter::BytesWritten:
+        return "bytes_written";
+    }
+    return "unknown";
+}
+
+void recordStage(const char *stage, const std::uint64_t calls, const double seconds)
+{
+    auto &r{registry()};
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (auto &s : r.stages)
+    {
+        if (s.name == stage)
+        {
+            s.calls += calls;
+            s.seconds += seconds;
+            return;
+        }
+    }
+    r.stages.push_back({ stage, calls, seconds });
+}
+
+void countWritten(std::ostream &os)
+{
+    const auto pos{os.tellp()};
+    if (pos > 0)
+    {
+        countEvent(Counter::BytesWritten, static_cast<std::uint64_t>(pos));
+    }
+}
+
+void countWritten(const std::string &fileName)
+{
+    std::error_code ec;
+    const auto size{std::filesystem::file_size(fileName, ec)};
+    if (!ec)
+    {
+        countEvent(Counter::BytesWritten, size);
+    }
+}
+
+#ifndef MULTIPAR_NO_INSTRUMENT
+
+ThreadCounters::~ThreadCounters()
+{
+    auto &r{registry()};
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (size_t i{0}; i < counterCount; ++i)
+    {
+        r.counters[i] += counts[i];
+    }
+}
+
+#endif // MULTIPAR_NO_INSTRUMENT
+
+Profile currentProfile()
+{
+    auto &r{registry()};
+    std::lock_guard<std::mutex> lock(r.mutex);
+    Profile profile;
+    profile.stages = r.stages;
+    profile.counters = r.counters;
+#ifndef MULTIPAR_NO_INSTRUMENT
+    for (size_t i{0}; i < counterCount; ++i)
+    {
+        profile.counters[i] += threadCounters.counts[i];
+    }
+#endif
+    return profile;
+}
+
+void Profile::print() const
+{
+#ifdef MULTIPAR_NO_INSTRUMENT
+    std::cout << "profile: instrumentation is compiled out" << std::endl;
+    return;
+#endif
+    std::cout << "profile:" << std::endl;
+    for (const auto &s : stages)
+    {
+        std::cout << "  " << std::left << std::setw(24) << s.name << std::right
+                  << std::setw(10) << s.calls << " calls " << std::setw(12) << s.seconds << " s" << std::endl;
+    }
+    for (size_t i{0}; i < counterCount; ++i)
+    {
+        std::cout << "  " << std::left << std::setw(24) << counterName(static_cast<Counter>(i)) << std::right
+                  << std::setw(10) << counters[i] << std::endl;
+    }
+}
+
+void writeProfile(const Profile &profile, const std::string &fileName)
+{
+    std::ofstream ofs(fileName);
+    if (!ofs.is_open())
+    {
+        throw my_error("Can't open file \"" + fileName + "\"");
+    }
+    ofs << "{\n  \"stages\": [";
+    for (size_t i{0}; i < profile.stages.size(); ++i)
+    {
+        const auto &s{profile.stages[i]};
+        ofs << (i > 0 ? "," : "") << "\n    {\"name\": \"" << s.name << "\", \"calls\": " << s.calls
+            << ", \"seconds\": " << std::setprecision(9) << s.seconds << "}";
+    }
+    ofs << "\n  ],\n  \"counters\": {";
+    for (size_t i{0}; i < counterCount; ++i)
+    {
+        ofs << (i > 0 ? "," : "") << "\n    \"" << counterName(static_cast<Counter>(i)) << "\": " << profile.counters[i];
+    }
+    ofs << "\n  }\n}\n";
+}
+
+ProfileAtExit::~ProfileAtExit()
+{
+    if (!_enabled)
+    {
+        return;
+    }
+    try
+    {
+        if (_fileName.empty())
+        {
+            currentProfile().print();
+        }
+        else
+        {
+            writeProfile(currentProfile(), _fileName);
+        }
+    }
+    catch (const std::exception &err)
+    {
+        std::cout << "Error: " << err.what() << std::endl;
+    }
+}
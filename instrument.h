@@ -0,0 +1,155 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Stage timers and event counters of a run. Everything here compiles to nothing
+// when MULTIPAR_NO_INSTRUMENT is defined (qmake CONFIG+=no_instrument).
+
+enum class Counter {
+    LinesRead,        // lines scanned by the parsers, empty ones included
+    LinesMatched,     // lines that matched a reference and a pattern
+    RowsFiltered,     // rows dropped by a RowFilter
+    RegexEvaluations, // std::regex_search calls of findChem
+    FitFunctionCalls, // FitFunction_2 evaluations by Minuit
+    FitIterations,    // solves of the bounded linear solver, the first one included
+    BytesWritten,     // reports, job results, caches and plots
+};
+
+const size_t counterCount{static_cast<size_t>(Counter::BytesWritten) + 1};
+
+const char *counterName(const Counter counter);
+
+struct ProfileStage {
+    std::string name;
+    std::uint64_t calls{0};
+    double seconds{0.0};
+};
+
+// Totals of all stages and counters so far, stages in the order they were first seen.
+struct Profile {
+    std::vector<ProfileStage> stages;
+    std::array<std::uint64_t, counterCount> counters{};
+    void print() const;
+};
+
+// Counts of the threads that are still running are not included, except for the calling thread:
+// every thread adds its counts to the totals when it exits.
+Profile currentProfile();
+
+void writeProfile(const Profile &profile, const std::string &fileName);
+
+// Adds calls and seconds to the totals of stage.
+void recordStage(const char *stage, const std::uint64_t calls, const double seconds);
+
+// Adds what os has written so far to Counter::BytesWritten.
+void countWritten(std::ostream &os);
+
+// Adds the size of fileName to Counter::BytesWritten, for files written by ROOT.
+void countWritten(const std::string &fileName);
+
+#ifndef MULTIPAR_NO_INSTRUMENT
+
+// Per thread counts, so counting costs a plain increment even on the hot paths of the parallel parsers.
+struct ThreadCounters {
+    std::array<std::uint64_t, counterCount> counts{};
+    ~ThreadCounters();
+};
+
+inline thread_local ThreadCounters threadCounters;
+
+inline void countEvent(const Counter counter, const std::uint64_t n = 1)
+{
+    threadCounters.counts[static_cast<size_t>(counter)] += n;
+}
+
+// Times its scope as one call of stage.
+class StageTimer
+{
+public:
+    explicit StageTimer(const char *stage) : _stage{stage}, _start{std::chrono::steady_clock::now()} {}
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+    ~StageTimer()
+    {
+        const std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - _start};
+        recordStage(_stage, 1, elapsed.count());
+    }
+private:
+    const char *_stage;
+    std::chrono::steady_clock::time_point _start;
+};
+
+// Sums many short start/stop intervals of stage locally and records them once when destroyed,
+// for steps of a per-line loop.
+class StageAccumulator
+{
+public:
+    explicit StageAccumulator(const char *stage) : _stage{stage} {}
+    StageAccumulator(const StageAccumulator &) = delete;
+    StageAccumulator &operator=(const StageAccumulator &) = delete;
+    ~StageAccumulator()
+    {
+        if (_calls > 0)
+        {
+            recordStage(_stage, _calls, std::chrono::duration<double>(_total).count());
+        }
+    }
+    void start()
+    {
+        _start = std::chrono::steady_clock::now();
+    }
+    void stop()
+    {
+        _total += std::chrono::steady_clock::now() - _start;
+        ++_calls;
+    }
+private:
+    const char *_stage;
+    std::chrono::steady_clock::time_point _start;
+    std::chrono::steady_clock::duration _total{0};
+    std::uint64_t _calls{0};
+};
+
+#else
+
+inline void countEvent(const Counter, const std::uint64_t = 1)
+{
+}
+
+class StageTimer
+{
+public:
+    explicit StageTimer(const char *) {}
+};
+
+class StageAccumulator
+{
+public:
+    explicit StageAccumulator(const char *) {}
+    void start() {}
+    void stop() {}
+};
+
+#endif // MULTIPAR_NO_INSTRUMENT
+
+// Prints the profile when destroyed, or writes it as JSON to fileName if it is not empty.
+// Nothing happens if it is not enabled.
+class ProfileAtExit
+{
+public:
+    ProfileAtExit(const bool enabled, const std::string &fileName) : _enabled{enabled}, _fileName{fileName} {}
+    ProfileAtExit(const ProfileAtExit &) = delete;
+    ProfileAtExit &operator=(const ProfileAtExit &) = delete;
+    ~ProfileAtExit();
+private:
+    bool _enabled;
+    std::string _fileName;
+};
+
+#endif // INSTRUMENT_H
@@ -0,0 +1,308 @@
+#include "jobs.h"
+#include "dataset.h"
+#include "instrument.h"
+#include "parser.h"
+#include "predict.h"
+#include "tablecache.h"
+#include "threadpool.h"
+#include "validation.h"
+
+#include <cmath>
+#include <fstream>
+#include <regex>
+
+namespace {
+
+std::string trim(const std::string &str)
+{
+    const auto first{str.find_first_not_of(" \t\r")};
+    if (first == std::string::npos)
+    {
+        return {};
+    }
+    return str.substr(first, str.find_last_not_of(" \t\r") - first + 1);
+}
+
+std::string valueName(const Data1::Value value)
+{
+    return value == Data1::Value::A ? "A" : "W";
+}
+
+void setJobKey(Job &job, const std::string &key, const std::string &value, const size_t lineNumber)
+{
+    std::vector<std::string_view> strs;
+    splitLineToViews(value, strs);
+    auto where{"line " + std::to_string(lineNumber) + ": "};
+    if (key == "file")
+    {
+        job.file = value;
+    }
+    else if (key == "chem")
+    {
+        job.chem = value;
+    }
+    else if (key == "elements")
+    {
+        job.elements.assign(strs.begin(), strs.end());
+    }
+    else if (key == "pattern")
+    {
+        job.pattern = value;
+    }
+    else if (key == "predict")
+    {
+        job.predict = value;
+    }
+    else if (key == "value")
+    {
+        if (value != "A" && value != "W")
+        {
+            throw my_error(where + "value must be A or W, got \"" + value + "\"");
+        }
+        job.value = value == "A" ? Data1::Value::A : Data1::Value::W;
+    }
+    else if (key.rfind("limit ", 0) == 0)
+    {
+        if (strs.size() != 2)
+        {
+            throw my_error(where + "limit expects \"lower upper\"");
+        }
+        job.limits[trim(key.substr(6))] = { columnToDouble(strs, 0, lineNumber), columnToDouble(strs, 1, lineNumber) };
+    }
+    else if (key == "yErr")
+    {
+        job.yErr = columnToDouble(strs, 0, lineNumber);
+    }
+    else if (key == "cv")
+    {
+        job.cv = true;
+        job.cvFolds = 0;
+        if (value != "loso")
+        {
+            const auto nFolds{strs.size() == 1 ? columnToDouble(strs, 0, lineNumber) : 0.0};
+            if (nFolds < 2 || nFolds != std::floor(nFolds))
+            {
+                throw my_error(where + "cv must be loso or a number of folds, got \"" + value + "\"");
+            }
+            job.cvFolds = static_cast<size_t>(nFolds);
+        }
+    }
+    else
+    {
+        throw my_error(where + "unknown key \"" + key + "\"");
+    }
+}
+
+// Parameter limits of job by index in the model of data: elements, then the intercept.
+std::map<size_t, ParLimits> parLimits(const Job &job, const Dataset &data)
+{
+    std::map<size_t, ParLimits> limits;
+    for (const auto &item : job.limits)
+    {
+        limits[item.first == "const" ? data.elements.size() : data.elementIndex(item.first)] = item.second;
+    }
+    return limits;
+}
+
+JobResult runJob(const Job &job,
+                 const Table &table,
+                 const std::map<std::string, ChemResult> &chem,
+                 const std::string &outDir)
+{
+    StageTimer timer("job");
+    JobResult result;
+    result.name = job.name;
+    const auto elements{job.elements.empty() ? table.elements : job.elements};
+    const auto data{selectDataset(table, elements, chem, std::regex{job.pattern})};
+    const auto predictData{selectDataset(table, elements, chem, std::regex{job.predict})};
+    const auto limits{parLimits(job, data)};
+
+    const auto rows{data.rowsWith(job.value)};
+    std::vector<double> y;
+    for (auto row : rows)
+    {
+        y.push_back(data.reference(row, job.value).value());
+    }
+    const auto fit{fitLinear(data.design(rows), y, std::vector<double>(y.size(), 1.0 / (job.yErr * job.yErr)), limits)};
+    result.rows = rows.size();
+    result.chi2 = fit.chi2;
+    result.ndf = fit.ndf;
+
+    const auto predicted{predict(predictData, fit.par)};
+    const auto stats{predictionStats(predictData, predicted, job.value)};
+    result.avg = stats.mean;
+    result.rmse = stats.rmse;
+
+    CrossValidation cv;
+    if (job.cv)
+    {
+        cv = crossValidate(data, job.value, job.cvFolds, limits, job.yErr, 1);
+        result.cvRmse = cv.rmse;
+    }
+
+    const auto outName{outDir + "/" + job.name + ".txt"};
+    std::ofstream ofs(outName);
+    if (!ofs.is_open())
+    {
+        throw my_error("Can't open file \"" + outName + "\"");
+    }
+    ofs << "job " << job.name << ": " << job.file << ", " << valueName(job.value)
+        << ", pattern " << job.pattern << ", predict " << job.predict << ", " << rows.size() << " rows" << std::endl;
+    ofs << "chi2 = " << fit.chi2 << " ndf = " << fit.ndf << std::endl;
+    for (size_t i{0}; i < fit.par.size(); ++i)
+    {
+        ofs << (i < elements.size() ? elements[i] : "const") << " " << fit.par[i] << "\u00B1" << fit.parErr[i]
+            << (fit.atLimit[i] ? " (at limit)" : "") << std::endl;
+    }
+    ofs << "convergence: avg = " << stats.mean << " stdAbs = " << stats.rmse << std::endl;
+    if (result.cvRmse >= 0.0)
+    {
+        ofs << "cross-validation: " << cv.folds.size() << " folds, rmse = " << cv.rmse << std::endl;
+    }
+    for (size_t row{0}; row < predictData.rows(); ++row)
+    {
+        auto v{predictData.reference(row, job.value)};
+        ofs << predictData.samples[predictData.rowSample[row]] << " " << predicted[row];
+        if (v.has_value())
+        {
+            ofs << " " << v.value();
+        }
+        ofs << std::endl;
+    }
+    countWritten(ofs);
+    return result;
+}
+
+}
+
+JobFile readJobFile(const std::string &fileName)
+{
+    std::ifstream ifs(fileName);
+    if (!ifs.is_open())
+    {
+        throw my_error("Can't open file \"" + fileName + "\"");
+    }
+    JobFile jobFile;
+    std::map<std::string, ChemResult> *chem{nullptr};
+    Job *job{nullptr};
+    std::string line;
+    std::vector<std::string_view> strs;
+    size_t lineNumber{0};
+    try
+    {
+        while (getline(ifs, line))
+        {
+            ++lineNumber;
+            line = trim(line.substr(0, line.find('#')));
+            if (line.empty())
+            {
+                continue;
+            }
+            if (line.front() == '[' && line.back() == ']')
+            {
+                splitLineToViews(std::string_view(line).substr(1, line.size() - 2), strs);
+                if (strs.size() != 2 || (strs[0] != "chem" && strs[0] != "job"))
+                {
+                    throw my_error("line " + std::to_string(lineNumber) + ": expected [chem name] or [job name]");
+                }
+                chem = nullptr;
+                job = nullptr;
+                if (strs[0] == "chem")
+                {
+                    chem = &jobFile.chem[std::string(strs[1])];
+                }
+                else
+                {
+                    jobFile.jobs.push_back({});
+                    job = &jobFile.jobs.back();
+                    job->name = std::string(strs[1]);
+                }
+                continue;
+            }
+            if (chem)
+            {
+                if (splitLineToViews(line, strs) != 3)
+                {
+                    throw my_error("line " + std::to_string(lineNumber) + ": expected \"key a w\"");
+                }
+                auto reference = [&strs, lineNumber](size_t column) -> std::optional<double> {
+                    if (strs[column] == "-")
+                    {
+                        return std::nullopt;
+                    }
+                    return columnToDouble(strs, column, lineNumber);
+                };
+                (*chem)[std::string(strs[0])] = { reference(1), reference(2) };
+                continue;
+            }
+            auto pos{line.find('=')};
+            if (!job || pos == std::string::npos)
+            {
+                throw my_error("line " + std::to_string(lineNumber) + ": expected \"key = value\" inside [job name]");
+            }
+            setJobKey(*job, trim(line.substr(0, pos)), trim(line.substr(pos + 1)), lineNumber);
+        }
+        for (const auto &j : jobFile.jobs)
+        {
+            if (j.file.empty() || jobFile.chem.find(j.chem) == jobFile.chem.end())
+            {
+                throw my_error("job \"" + j.name + "\" needs a file and a known chem table");
+            }
+        }
+    }
+    catch (const my_error &err)
+    {
+        throw my_error(fileName + ": " + err.what());
+    }
+    return jobFile;
+}
+
+std::vector<JobResult> runJobs(const JobFile &jobFile,
+                               const std::string &outDir,
+                               const unsigned int nThreads)
+{
+    std::map<std::string, Table> tables;
+    for (const auto &job : jobFile.jobs)
+    {
+        if (tables.find(job.file) == tables.end())
+        {
+            tables[job.file] = readTableCached(job.file, {}, nThreads);
+        }
+    }
+
+    std::vector<JobResult> results(jobFile.jobs.size());
+    ThreadPool pool(defaultThreads(nThreads) - 1);
+    pool.parallelFor(jobFile.jobs.size(), [&](size_t i){
+        const auto &job{jobFile.jobs[i]};
+        try
+        {
+            results[i] = runJob(job, tables.at(job.file), jobFile.chem.at(job.chem), outDir);
+        }
+        catch (const std::exception &err)
+        {
+            results[i].name = job.name;
+            results[i].error = err.what();
+        }
+    });
+    return results;
+}
+
+void printJobResults(const std::vector<JobResult> &results)
+{
+    for (const auto &r : results)
+    {
+        std::cout << r.name << ": ";
+        if (!r.error.empty())
+        {
+            std::cout << "Error: " << r.error << std::endl;
+            continue;
+        }
+        std::cout << r.rows << " rows, chi2/ndf = " << r.chi2 << "/" << r.ndf
+                  << ", avg = " << r.avg << ", stdAbs = " << r.rmse;
+        if (r.cvRmse >= 0.0)
+        {
+            std::cout << ", cv rmse = " << r.cvRmse;
+        }
+        std::cout << std::endl;
+    }
+}
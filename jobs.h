@@ -0,0 +1,68 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "common.h"
+#include "lsq.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// One calibration variant. A job file lists reference tables and jobs:
+//
+//   [chem ref]            reference table "ref", one "key a w" line per sample, "-" for a missing value
+//   3835 7.8 4.2
+//   bereza_1_ 9.3 -
+//
+//   [job A_all]           job "A_all", "key = value" lines, all keys but file and chem are optional
+//   file = rea.elts.txt.wo_MgCaFeS.all
+//   chem = ref
+//   elements = Al C N O Si        default - every element of the file header
+//   pattern = \d+_\d\.            calibration rows
+//   predict = sum                 rows the calibration is applied to
+//   value = A                     A or W
+//   limit C = -5 0                limits by element, "const" is the intercept
+//   limit const = 50 150
+//   yErr = 0.5
+//   cv = loso                     loso or the number of folds, no cross-validation by default
+struct Job {
+    std::string name;
+    std::string file;
+    std::string chem;
+    std::vector<std::string> elements;
+    std::string pattern{"\\d+_\\d\\."};
+    std::string predict{"sum"};
+    Data1::Value value{Data1::Value::A};
+    std::map<std::string, ParLimits> limits;
+    double yErr{0.5};
+    bool cv{false};
+    size_t cvFolds{0}; // 0 - leave one sample out
+};
+
+struct JobFile {
+    std::map<std::string, std::map<std::string, ChemResult>> chem;
+    std::vector<Job> jobs;
+};
+
+JobFile readJobFile(const std::string &fileName);
+
+struct JobResult {
+    std::string name;
+    std::string error; // empty if the job succeeded
+    size_t rows{0};
+    double chi2{0.0};
+    int ndf{0};
+    double avg{0.0};   // mean prediction of the predict rows with a reference
+    double rmse{0.0};  // of those predictions
+    double cvRmse{-1.0};
+};
+
+// Reads every input file once (through its binary cache, see tablecache.h), then runs the jobs concurrently on nThreads threads (0 - hardware concurrency)
+// against the shared tables. Each job writes its report to outDir/<name>.txt, a failing job does not stop the others.
+std::vector<JobResult> runJobs(const JobFile &jobFile,
+                               const std::string &outDir,
+                               const unsigned int nThreads = 0);
+
+void printJobResults(const std::vector<JobResult> &results);
+
+#endif // JOBS_H
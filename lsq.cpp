@@ -0,0 +1,863 @@
+#include "lsq.h"
+#include "common.h"
+#include "instrument.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+void LinearFit::print() const
+{
+    std::cout << "linear fit: chi2 = " << chi2 << " ndf = " << ndf << " iterations = " << iterations << std::endl;
+    for (size_t i{0}; i < par.size(); ++i)
+    {
+        std::cout << "p" << i << " = " << par[i] << "\u00B1" << parErr[i] << (atLimit[i] ? " (at limit)" : "") << std::endl;
+    }
+}
+
+namespace {
+
+const double rankTolerance{1e-12};
+
+struct QRSolution {
+    std::vector<double> x;
+    std::vector<double> cov; // k x k, row-major, (A^T A)^-1
+    size_t rank{0};
+};
+
+// Least squares for the k columns a (each of n rows) and the right-hand side b,
+// Householder QR with column pivoting. a and b are overwritten.
+QRSolution solveQR(std::vector<std::vector<double>> &a, std::vector<double> &b)
+{
+    const auto k{a.size()};
+    const auto n{b.size()};
+    std::vector<size_t> perm(k);
+    std::iota(perm.begin(), perm.end(), 0);
+
+    QRSolution s;
+    s.x.assign(k, 0.0);
+    s.cov.assign(k * k, 0.0);
+
+    auto colNorm2 = [&a, n](size_t m, size_t from){
+        auto sum{0.0};
+        for (auto i{from}; i < n; ++i)
+        {
+            sum += a[m][i] * a[m][i];
+        }
+        return sum;
+    };
+    auto maxNorm{0.0};
+    for (size_t m{0}; m < k; ++m)
+    {
+        maxNorm = std::max(maxNorm, std::sqrt(colNorm2(m, 0)));
+    }
+
+    const auto steps{std::min(n, k)};
+    for (size_t j{0}; j < steps; ++j)
+    {
+        auto p{j};
+        auto pNorm2{colNorm2(j, j)};
+        for (auto m{j + 1}; m < k; ++m)
+        {
+            auto norm2{colNorm2(m, j)};
+            if (norm2 > pNorm2)
+            {
+                p = m;
+                pNorm2 = norm2;
+            }
+        }
+        auto norm{std::sqrt(pNorm2)};
+        if (norm <= rankTolerance * maxNorm)
+        {
+            break;
+        }
+        std::swap(a[j], a[p]);
+        std::swap(perm[j], perm[p]);
+        ++s.rank;
+
+        auto alpha{a[j][j] > 0.0 ? -norm : norm};
+        std::vector<double> v(a[j].begin() + static_cast<long>(j), a[j].end());
+        v.front() -= alpha;
+        auto vNorm2{std::inner_product(v.begin(), v.end(), v.begin(), 0.0)};
+        auto reflect = [&v, vNorm2, j, n](std::vector<double> &col){
+            auto dot{0.0};
+            for (auto i{j}; i < n; ++i)
+            {
+                dot += v[i - j] * col[i];
+            }
+            auto scale{2.0 * dot / vNorm2};
+            for (auto i{j}; i < n; ++i)
+            {
+                col[i] -= scale * v[i - j];
+            }
+        };
+        if (vNorm2 > 0.0)
+        {
+            for (auto m{j + 1}; m < k; ++m)
+            {
+                reflect(a[m]);
+            }
+            reflect(b);
+        }
+        a[j][j] = alpha;
+    }
+
+    const auto r{s.rank};
+    // R(i, j) = a[j][i], i <= j < r
+    std::vector<double> z(r);
+    for (auto i{r}; i-- > 0;)
+    {
+        auto sum{b[i]};
+        for (auto j{i + 1}; j < r; ++j)
+        {
+            sum -= a[j][i] * z[j];
+        }
+        z[i] = sum / a[i][i];
+    }
+    // R^-1, upper triangular
+    std::vector<double> rInv(r * r, 0.0);
+    for (size_t c{0}; c < r; ++c)
+    {
+        rInv[c * r + c] = 1.0 / a[c][c];
+        for (auto i{c}; i-- > 0;)
+        {
+            auto sum{0.0};
+            for (auto j{i + 1}; j <= c; ++j)
+            {
+                sum += a[j][i] * rInv[j * r + c];
+            }
+            rInv[i * r + c] = -sum / a[i][i];
+        }
+    }
+    for (size_t i{0}; i < r; ++i)
+    {
+        s.x[perm[i]] = z[i];
+        for (size_t j{0}; j < r; ++j)
+        {
+            auto sum{0.0};
+            for (auto m{std::max(i, j)}; m < r; ++m)
+            {
+                sum += rInv[i * r + m] * rInv[j * r + m];
+            }
+            s.cov[perm[i] * k + perm[j]] = sum;
+        }
+    }
+    return s;
+}
+
+enum class BoundState {
+    Free,
+    Lower,
+    Upper
+};
+
+std::vector<size_t> freeIndices(const std::vector<BoundState> &state)
+{
+    std::vector<size_t> idx;
+    for (size_t j{0}; j < state.size(); ++j)
+    {
+        if (state[j] == BoundState::Free)
+        {
+            idx.push_back(j);
+        }
+    }
+    return idx;
+}
+
+void checkLimits(const std::map<size_t, ParLimits> &limits, const size_t nPar, const std::string &caller)
+{
+    for (const auto &item : limits)
+    {
+        if (item.first >= nPar || item.second.lower > item.second.upper)
+        {
+            throw my_error(caller + ": bad limits for parameter " + std::to_string(item.first));
+        }
+    }
+}
+
+// Active set iterations of the bounded-variable least squares (Stark & Parker).
+// solveFree(state, x) returns x with the free parameters replaced by their least squares solution
+// for the others fixed at x, gradient(x, g) fills the gradient of chi2 / 2 and returns its scale.
+// On return the last solveFree call was made for the final state.
+template <typename SolveFree, typename Gradient>
+int solveBounded(const std::map<size_t, ParLimits> &limits,
+                 std::vector<BoundState> &state,
+                 std::vector<double> &x,
+                 SolveFree solveFree,
+                 Gradient gradient,
+                 const std::string &caller)
+{
+    const auto nPar{x.size()};
+    state.assign(nPar, BoundState::Free);
+    countEvent(Counter::FitIterations);
+    x = solveFree(state, x);
+    for (const auto &item : limits)
+    {
+        if (x[item.first] <= item.second.lower)
+        {
+            x[item.first] = item.second.lower;
+            state[item.first] = BoundState::Lower;
+        }
+        else if (x[item.first] >= item.second.upper)
+        {
+            x[item.first] = item.second.upper;
+            state[item.first] = BoundState::Upper;
+        }
+    }
+    if (std::all_of(state.begin(), state.end(), [](BoundState s){ return s == BoundState::Free; }))
+    {
+        return 0;
+    }
+
+    const auto maxIterations{10 * static_cast<int>(nPar) + 10};
+    std::vector<double> g(nPar);
+    for (int iteration{1}; iteration <= maxIterations; ++iteration)
+    {
+        countEvent(Counter::FitIterations);
+        auto z{solveFree(state, x)};
+
+        // step towards z until the first free bounded parameter hits its limit
+        auto alpha{1.0};
+        size_t blocking{nPar};
+        for (size_t j{0}; j < nPar; ++j)
+        {
+            auto it{limits.find(j)};
+            if (state[j] != BoundState::Free || it == limits.end() || z[j] == x[j])
+            {
+                continue;
+            }
+            double t{1.0};
+            if (z[j] < it->second.lower)
+            {
+                t = (it->second.lower - x[j]) / (z[j] - x[j]);
+            }
+            else if (z[j] > it->second.upper)
+            {
+                t = (it->second.upper - x[j]) / (z[j] - x[j]);
+            }
+            if (t < alpha)
+            {
+                alpha = t;
+                blocking = j;
+            }
+        }
+        if (blocking < nPar)
+        {
+            for (size_t j{0}; j < nPar; ++j)
+            {
+                if (state[j] == BoundState::Free)
+                {
+                    x[j] += alpha * (z[j] - x[j]);
+                }
+            }
+            const auto &lim{limits.at(blocking)};
+            state[blocking] = z[blocking] < lim.lower ? BoundState::Lower : BoundState::Upper;
+            x[blocking] = state[blocking] == BoundState::Lower ? lim.lower : lim.upper;
+            continue;
+        }
+        x = z;
+
+        // release the bound parameter whose gradient points most strongly into the box
+        auto worst{1e-10 * gradient(x, g)};
+        size_t release{nPar};
+        for (size_t j{0}; j < nPar; ++j)
+        {
+            auto violation{state[j] == BoundState::Lower ? -g[j] : state[j] == BoundState::Upper ? g[j] : 0.0};
+            if (violation > worst)
+            {
+                worst = violation;
+                release = j;
+            }
+        }
+        if (release == nPar)
+        {
+            return iteration;
+        }
+        state[release] = BoundState::Free;
+    }
+    throw my_error(caller + ": bounded solver did not converge in " + std::to_string(maxIterations) + " iterations");
+}
+
+// Fills par errors, covariance and limit flags from the covariance of the free parameters.
+void setCovariance(LinearFit &fit, const std::vector<BoundState> &state, const std::vector<double> &freeCov)
+{
+    const auto nPar{state.size()};
+    const auto freeIdx{freeIndices(state)};
+    fit.parErr.assign(nPar, 0.0);
+    fit.cov.assign(nPar * nPar, 0.0);
+    fit.atLimit.assign(nPar, false);
+    for (size_t m{0}; m < freeIdx.size(); ++m)
+    {
+        for (size_t l{0}; l < freeIdx.size(); ++l)
+        {
+            fit.cov[freeIdx[m] * nPar + freeIdx[l]] = freeCov[m * freeIdx.size() + l];
+        }
+        fit.parErr[freeIdx[m]] = std::sqrt(freeCov[m * freeIdx.size() + m]);
+    }
+    for (size_t j{0}; j < nPar; ++j)
+    {
+        fit.atLimit[j] = state[j] != BoundState::Free;
+    }
+}
+
+}
+
+LinearFit fitLinear(const std::vector<std::vector<double>> &columns,
+                    const std::vector<double> &y,
+                    const std::vector<double> &w,
+                    const std::map<size_t, ParLimits> &limits)
+{
+    const auto nPar{columns.size()};
+    const auto n{y.size()};
+    if (nPar == 0 || n < nPar || w.size() != n)
+    {
+        throw my_error("fitLinear: " + std::to_string(n) + " points are not enough for " + std::to_string(nPar) + " parameters");
+    }
+    for (const auto &col : columns)
+    {
+        if (col.size() != n)
+        {
+            throw my_error("fitLinear: column size mismatch");
+        }
+    }
+    checkLimits(limits, nPar, "fitLinear");
+
+    std::vector<double> sqrtW(n);
+    std::transform(w.begin(), w.end(), sqrtW.begin(), [](double v){ return std::sqrt(v); });
+
+    QRSolution last;
+    // solves for the free parameters with the others fixed at their current values
+    auto solveFree = [&](const std::vector<BoundState> &state, const std::vector<double> &x){
+        const auto freeIdx{freeIndices(state)};
+        std::vector<double> rhs(y);
+        for (size_t j{0}; j < nPar; ++j)
+        {
+            if (state[j] != BoundState::Free)
+            {
+                for (size_t i{0}; i < n; ++i)
+                {
+                    rhs[i] -= x[j] * columns[j][i];
+                }
+            }
+        }
+        std::vector<std::vector<double>> a(freeIdx.size(), std::vector<double>(n));
+        for (size_t m{0}; m < freeIdx.size(); ++m)
+        {
+            for (size_t i{0}; i < n; ++i)
+            {
+                a[m][i] = sqrtW[i] * columns[freeIdx[m]][i];
+            }
+        }
+        for (size_t i{0}; i < n; ++i)
+        {
+            rhs[i] *= sqrtW[i];
+        }
+        last = solveQR(a, rhs);
+        std::vector<double> z(x);
+        for (size_t m{0}; m < freeIdx.size(); ++m)
+        {
+            z[freeIdx[m]] = last.x[m];
+        }
+        return z;
+    };
+
+    auto residuals = [&](const std::vector<double> &p){
+        std::vector<double> res(y);
+        for (size_t j{0}; j < nPar; ++j)
+        {
+            for (size_t i{0}; i < n; ++i)
+            {
+                res[i] -= p[j] * columns[j][i];
+            }
+        }
+        return res;
+    };
+
+    auto gradient = [&](const std::vector<double> &x, std::vector<double> &g){
+        auto res{residuals(x)};
+        auto gScale{0.0};
+        for (size_t j{0}; j < nPar; ++j)
+        {
+            g[j] = 0.0;
+            auto norm2{0.0};
+            for (size_t i{0}; i < n; ++i)
+            {
+                g[j] -= w[i] * columns[j][i] * res[i];
+                norm2 += w[i] * columns[j][i] * columns[j][i];
+            }
+            gScale = std::max(gScale, std::sqrt(norm2));
+        }
+        return gScale;
+    };
+
+    LinearFit fit;
+    std::vector<BoundState> state;
+    std::vector<double> x(nPar, 0.0);
+    fit.iterations = solveBounded(limits, state, x, solveFree, gradient, "fitLinear");
+
+    fit.par = x;
+    setCovariance(fit, state, last.cov);
+    auto res{residuals(x)};
+    for (size_t i{0}; i < n; ++i)
+    {
+        fit.chi2 += w[i] * res[i] * res[i];
+    }
+    fit.ndf = static_cast<int>(n) - static_cast<int>(nPar);
+    return fit;
+}
+
+std::vector<CompressedRows> compressRows(const std::vector<std::vector<double>> &columns,
+                                         const std::vector<std::vector<double>> &ys,
+                                         const std::vector<double> &w)
+{
+    const auto nPar{columns.size()};
+    const auto n{w.size()};
+    std::vector<std::vector<double>> a(columns);
+    std::vector<std::vector<double>> b(ys);
+    for (size_t i{0}; i < n; ++i)
+    {
+        const auto sqrtW{std::sqrt(w[i])};
+        for (auto &col : a)
+        {
+            col[i] *= sqrtW;
+        }
+        for (auto &y : b)
+        {
+            y[i] *= sqrtW;
+        }
+    }
+    const auto m{std::min(n, nPar)};
+    for (size_t j{0}; j < m; ++j)
+    {
+        auto norm2{0.0};
+        for (auto i{j}; i < n; ++i)
+        {
+            norm2 += a[j][i] * a[j][i];
+        }
+        if (norm2 == 0.0)
+        {
+            continue;
+        }
+        auto alpha{a[j][j] > 0.0 ? -std::sqrt(norm2) : std::sqrt(norm2)};
+        std::vector<double> v(a[j].begin() + static_cast<long>(j), a[j].end());
+        v.front() -= alpha;
+        auto vNorm2{std::inner_product(v.begin(), v.end(), v.begin(), 0.0)};
+        auto reflect = [&v, vNorm2, j, n](std::vector<double> &col){
+            auto dot{0.0};
+            for (auto i{j}; i < n; ++i)
+            {
+                dot += v[i - j] * col[i];
+            }
+            auto scale{2.0 * dot / vNorm2};
+            for (auto i{j}; i < n; ++i)
+            {
+                col[i] -= scale * v[i - j];
+            }
+        };
+        for (auto k{j + 1}; k < nPar; ++k)
+        {
+            reflect(a[k]);
+        }
+        for (auto &y : b)
+        {
+            reflect(y);
+        }
+        a[j][j] = alpha;
+    }
+
+    CompressedRows c;
+    c.n = n;
+    c.columns.assign(nPar, std::vector<double>(m, 0.0));
+    for (size_t j{0}; j < nPar; ++j)
+    {
+        for (size_t i{0}; i < m && i <= j; ++i)
+        {
+            c.columns[j][i] = a[j][i];
+        }
+    }
+    std::vector<CompressedRows> r(b.size(), c);
+    for (size_t t{0}; t < b.size(); ++t)
+    {
+        r[t].y.assign(b[t].begin(), b[t].begin() + static_cast<long>(m));
+        for (auto i{m}; i < n; ++i)
+        {
+            r[t].rss += b[t][i] * b[t][i];
+        }
+    }
+    return r;
+}
+
+CompressedRows compressRows(const std::vector<std::vector<double>> &columns,
+                            const std::vector<double> &y,
+                            const std::vector<double> &w)
+{
+    if (y.size() != w.size())
+    {
+        throw my_error("compressRows: size mismatch");
+    }
+    return compressRows(columns, std::vector<std::vector<double>>{ y }, w).front();
+}
+
+NormalEquations::NormalEquations(const size_t nPar)
+    : nPar{nPar}, xtx(nPar * nPar, 0.0), xty(nPar, 0.0)
+{}
+
+void NormalEquations::add(const double *x, const double y, const double w)
+{
+    for (size_t i{0}; i < nPar; ++i)
+    {
+        const auto wx{w * x[i]};
+        for (size_t j{0}; j < nPar; ++j)
+        {
+            xtx[i * nPar + j] += wx * x[j];
+        }
+        xty[i] += wx * y;
+    }
+    yty += w * y * y;
+    sumW += w;
+    ++n;
+}
+
+NormalEquations &NormalEquations::operator+=(const NormalEquations &other)
+{
+    if (nPar == 0 && n == 0)
+    {
+        return *this = other;
+    }
+    if (other.nPar != nPar)
+    {
+        throw my_error("NormalEquations: adding " + std::to_string(other.nPar) + " parameters to " + std::to_string(nPar));
+    }
+    for (size_t i{0}; i < xtx.size(); ++i)
+    {
+        xtx[i] += other.xtx[i];
+    }
+    for (size_t i{0}; i < nPar; ++i)
+    {
+        xty[i] += other.xty[i];
+    }
+    yty += other.yty;
+    sumW += other.sumW;
+    n += other.n;
+    return *this;
+}
+
+NormalEquations &NormalEquations::operator-=(const NormalEquations &other)
+{
+    if (other.nPar != nPar || other.n > n)
+    {
+        throw my_error("NormalEquations: can't subtract rows that were not added");
+    }
+    for (size_t i{0}; i < xtx.size(); ++i)
+    {
+        xtx[i] -= other.xtx[i];
+    }
+    for (size_t i{0}; i < nPar; ++i)
+    {
+        xty[i] -= other.xty[i];
+    }
+    yty -= other.yty;
+    sumW -= other.sumW;
+    n -= other.n;
+    return *this;
+}
+
+NormalEquations NormalEquations::subset(const std::vector<size_t> &idx) const
+{
+    NormalEquations ne(idx.size());
+    for (size_t i{0}; i < idx.size(); ++i)
+    {
+        for (size_t j{0}; j < idx.size(); ++j)
+        {
+            ne.xtx[i * idx.size() + j] = xtx[idx[i] * nPar + idx[j]];
+        }
+        ne.xty[i] = xty[idx[i]];
+    }
+    ne.yty = yty;
+    ne.sumW = sumW;
+    ne.n = n;
+    return ne;
+}
+
+double NormalEquations::chi2(const std::vector<double> &par) const
+{
+    auto res{yty};
+    for (size_t i{0}; i < nPar; ++i)
+    {
+        auto row{0.0};
+        for (size_t j{0}; j < nPar; ++j)
+        {
+            row += xtx[i * nPar + j] * par[j];
+        }
+        res += par[i] * (row - 2.0 * xty[i]);
+    }
+    return std::max(res, 0.0);
+}
+
+bool choleskyDecompose(std::vector<double> &a, const size_t n)
+{
+    auto maxDiag{0.0};
+    for (size_t i{0}; i < n; ++i)
+    {
+        maxDiag = std::max(maxDiag, a[i * n + i]);
+    }
+    for (size_t j{0}; j < n; ++j)
+    {
+        auto d{a[j * n + j]};
+        for (size_t k{0}; k < j; ++k)
+        {
+            d -= a[j * n + k] * a[j * n + k];
+        }
+        if (!(d > rankTolerance * maxDiag))
+        {
+            return false;
+        }
+        d = std::sqrt(d);
+        a[j * n + j] = d;
+        for (auto i{j + 1}; i < n; ++i)
+        {
+            auto s{a[i * n + j]};
+            for (size_t k{0}; k < j; ++k)
+            {
+                s -= a[i * n + k] * a[j * n + k];
+            }
+            a[i * n + j] = s / d;
+        }
+    }
+    return true;
+}
+
+void choleskySolve(const std::vector<double> &l, const size_t n, std::vector<double> &b)
+{
+    for (size_t i{0}; i < n; ++i)
+    {
+        auto s{b[i]};
+        for (size_t k{0}; k < i; ++k)
+        {
+            s -= l[i * n + k] * b[k];
+        }
+        b[i] = s / l[i * n + i];
+    }
+    for (auto i{n}; i-- > 0;)
+    {
+        auto s{b[i]};
+        for (auto k{i + 1}; k < n; ++k)
+        {
+            s -= l[k * n + i] * b[k];
+        }
+        b[i] = s / l[i * n + i];
+    }
+}
+
+LinearFit solveNormalEquations(const NormalEquations &ne,
+                               const std::map<size_t, ParLimits> &limits)
+{
+    const auto nPar{ne.nPar};
+    if (ne.n < nPar)
+    {
+        throw my_error("solveNormalEquations: " + std::to_string(ne.n) + " points are not enough for " + std::to_string(nPar) + " parameters");
+    }
+    checkLimits(limits, nPar, "solveNormalEquations");
+
+    std::vector<double> freeCov;
+    auto solveFree = [&](const std::vector<BoundState> &state, const std::vector<double> &x){
+        const auto freeIdx{freeIndices(state)};
+        const auto p{freeIdx.size()};
+        std::vector<double> l(p * p);
+        std::vector<double> z(x);
+        std::vector<double> rhs(p);
+        for (size_t m{0}; m < p; ++m)
+        {
+            rhs[m] = ne.xty[freeIdx[m]];
+            for (size_t j{0}; j < nPar; ++j)
+            {
+                if (state[j] != BoundState::Free)
+                {
+                    rhs[m] -= ne.xtx[freeIdx[m] * nPar + j] * x[j];
+                }
+            }
+            for (size_t k{0}; k < p; ++k)
+            {
+                l[m * p + k] = ne.xtx[freeIdx[m] * nPar + freeIdx[k]];
+            }
+        }
+        if (!choleskyDecompose(l, p))
+        {
+            throw my_error("solveNormalEquations: singular normal equations");
+        }
+        choleskySolve(l, p, rhs);
+        freeCov.assign(p * p, 0.0);
+        for (size_t k{0}; k < p; ++k)
+        {
+            std::vector<double> e(p, 0.0);
+            e[k] = 1.0;
+            choleskySolve(l, p, e);
+            for (size_t m{0}; m < p; ++m)
+            {
+                freeCov[m * p + k] = e[m];
+            }
+        }
+        for (size_t m{0}; m < p; ++m)
+        {
+            z[freeIdx[m]] = rhs[m];
+        }
+        return z;
+    };
+
+    auto gradient = [&](const std::vector<double> &x, std::vector<double> &g){
+        auto gScale{0.0};
+        for (size_t i{0}; i < nPar; ++i)
+        {
+            g[i] = -ne.xty[i];
+            for (size_t j{0}; j < nPar; ++j)
+            {
+                g[i] += ne.xtx[i * nPar + j] * x[j];
+            }
+            gScale = std::max(gScale, std::sqrt(ne.xtx[i * nPar + i]));
+        }
+        return gScale;
+    };
+
+    LinearFit fit;
+    std::vector<BoundState> state;
+    std::vector<double> x(nPar, 0.0);
+    fit.iterations = solveBounded(limits, state, x, solveFree, gradient, "solveNormalEquations");
+    fit.par = x;
+    setCovariance(fit, state, freeCov);
+    fit.chi2 = ne.chi2(fit.par);
+    fit.ndf = static_cast<int>(ne.n) - static_cast<int>(nPar);
+    return fit;
+}
+
+RecursiveLeastSquares::RecursiveLeastSquares(const LinearFit &fit,
+                                             const std::map<size_t, ParLimits> &limits,
+                                             const double forgetting)
+    : _par{fit.par}, _limits{limits}, _forgetting{forgetting}
+{
+    const auto nPar{_par.size()};
+    if (fit.cov.size() != nPar * nPar || fit.atLimit.size() != nPar)
+    {
+        throw my_error("RecursiveLeastSquares: fit has no covariance");
+    }
+    if (forgetting <= 0.0 || forgetting > 1.0)
+    {
+        throw my_error("RecursiveLeastSquares: forgetting factor must be in (0, 1]");
+    }
+    checkLimits(limits, nPar, "RecursiveLeastSquares");
+    for (size_t j{0}; j < nPar; ++j)
+    {
+        if (!fit.atLimit[j])
+        {
+            _free.push_back(j);
+        }
+    }
+    const auto nFree{_free.size()};
+    _p.resize(nFree * nFree);
+    for (size_t m{0}; m < nFree; ++m)
+    {
+        for (size_t l{0}; l < nFree; ++l)
+        {
+            _p[m * nFree + l] = fit.cov[_free[m] * nPar + _free[l]];
+        }
+    }
+}
+
+double RecursiveLeastSquares::predict(const double *x) const
+{
+    auto res{0.0};
+    for (size_t j{0}; j < _par.size(); ++j)
+    {
+        res += _par[j] * x[j];
+    }
+    return res;
+}
+
+void RecursiveLeastSquares::update(const double *x, const double y, const double w)
+{
+    const auto nFree{_free.size()};
+    const auto e{y - predict(x)};
+    std::vector<double> px(nFree, 0.0);
+    auto xpx{0.0};
+    for (size_t m{0}; m < nFree; ++m)
+    {
+        for (size_t l{0}; l < nFree; ++l)
+        {
+            px[m] += _p[m * nFree + l] * x[_free[l]];
+        }
+        xpx += x[_free[m]] * px[m];
+    }
+    const auto denom{_forgetting / w + xpx};
+    for (size_t m{0}; m < nFree; ++m)
+    {
+        _par[_free[m]] += px[m] / denom * e;
+    }
+    for (size_t m{0}; m < nFree; ++m)
+    {
+        for (size_t l{0}; l < nFree; ++l)
+        {
+            _p[m * nFree + l] = (_p[m * nFree + l] - px[m] * px[l] / denom) / _forgetting;
+        }
+    }
+    ++_updates;
+
+    // fix the parameter furthest outside its box until all free ones are inside
+    for (;;)
+    {
+        size_t worst{_free.size()};
+        auto worstDist{0.0};
+        auto worstValue{0.0};
+        for (size_t m{0}; m < _free.size(); ++m)
+        {
+            auto it{_limits.find(_free[m])};
+            if (it == _limits.end())
+            {
+                continue;
+            }
+            const auto v{_par[_free[m]]};
+            const auto bound{std::clamp(v, it->second.lower, it->second.upper)};
+            if (std::abs(v - bound) > worstDist)
+            {
+                worst = m;
+                worstDist = std::abs(v - bound);
+                worstValue = bound;
+            }
+        }
+        if (worst == _free.size())
+        {
+            break;
+        }
+        fix(worst, worstValue);
+    }
+}
+
+void RecursiveLeastSquares::fix(const size_t m, const double value)
+{
+    // conditioning the quadratic on par[m] = value: the minimum of the others moves along column m of P
+    const auto nFree{_free.size()};
+    const auto pmm{_p[m * nFree + m]};
+    const auto delta{value - _par[_free[m]]};
+    for (size_t l{0}; l < nFree; ++l)
+    {
+        if (pmm > 0.0)
+        {
+            _par[_free[l]] += _p[l * nFree + m] / pmm * delta;
+        }
+    }
+    _par[_free[m]] = value;
+
+    std::vector<double> p;
+    p.reserve((nFree - 1) * (nFree - 1));
+    for (size_t i{0}; i < nFree; ++i)
+    {
+        for (size_t l{0}; l < nFree && i != m; ++l)
+        {
+            if (l != m)
+            {
+                p.push_back(pmm > 0.0 ? _p[i * nFree + l] - _p[i * nFree + m] * _p[m * nFree + l] / pmm
+                                      : _p[i * nFree + l]);
+            }
+        }
+    }
+    _p = std::move(p);
+    _free.erase(_free.begin() + static_cast<long>(m));
+}
@@ -0,0 +1,124 @@
+#ifndef LSQ_H
+#define LSQ_H
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+// Same meaning as TF1::SetParLimits(i, lower, upper).
+struct ParLimits {
+    double lower;
+    double upper;
+};
+
+struct LinearFit {
+    std::vector<double> par;
+    std::vector<double> parErr;
+    std::vector<double> cov; // nPar x nPar, row-major
+    std::vector<bool> atLimit;
+    double chi2{0.0};
+    int ndf{0};
+    int iterations{0};
+    void print() const;
+};
+
+// Weighted linear least squares: minimizes sum_r w[r] * (y[r] - sum_i par[i] * columns[i][r])^2,
+// so with w = 1 / yErr^2 the result is the chi2 fit of TGraphErrors::Fit.
+// Parameters listed in limits are kept inside their box by a bounded-variable (active set) solver,
+// every subproblem is solved by Householder QR with column pivoting.
+// The covariance is (X^T W X)^-1 of the parameters not sitting on a limit,
+// parameters fixed on a limit get zero errors.
+LinearFit fitLinear(const std::vector<std::vector<double>> &columns,
+                    const std::vector<double> &y,
+                    const std::vector<double> &w,
+                    const std::map<size_t, ParLimits> &limits = {});
+
+// Rows reduced by Householder QR to at most nPar unit-weight pseudo-rows that have the same
+// X^T W X and X^T W y as the original rows, rss is the weighted residual sum no parameter can explain.
+// Fitting pseudo-rows of several row sets together is the fit of all their rows with chi2 lower by the rss.
+struct CompressedRows {
+    std::vector<std::vector<double>> columns;
+    std::vector<double> y;
+    double rss{0.0};
+    size_t n{0};
+};
+
+CompressedRows compressRows(const std::vector<std::vector<double>> &columns,
+                            const std::vector<double> &y,
+                            const std::vector<double> &w);
+
+// compressRows for several right-hand sides of the same rows: the rows are factorized once
+// and every y is carried through the same reflections, one result per y.
+std::vector<CompressedRows> compressRows(const std::vector<std::vector<double>> &columns,
+                                         const std::vector<std::vector<double>> &ys,
+                                         const std::vector<double> &w);
+
+// Weighted normal equations X^T W X, X^T W y and y^T W y of a linear model, accumulated row by row.
+// Sums of disjoint row sets can be added and subtracted.
+struct NormalEquations {
+    NormalEquations() = default;
+    explicit NormalEquations(const size_t nPar);
+
+    size_t nPar{0};
+    std::vector<double> xtx; // nPar x nPar, row-major, symmetric
+    std::vector<double> xty;
+    double yty{0.0};
+    double sumW{0.0};
+    size_t n{0};
+
+    void add(const double *x, const double y, const double w);
+    NormalEquations &operator+=(const NormalEquations &other);
+    NormalEquations &operator-=(const NormalEquations &other);
+    // Normal equations of the model built from the parameters idx only.
+    NormalEquations subset(const std::vector<size_t> &idx) const;
+    // Weighted sum of squared residuals of par on the accumulated rows.
+    double chi2(const std::vector<double> &par) const;
+};
+
+// In-place Cholesky factorization a = L L^T of the n x n row-major matrix a, L is left in the lower triangle.
+// Returns false if a is not numerically positive definite.
+bool choleskyDecompose(std::vector<double> &a, const size_t n);
+
+// Solves L L^T x = b in place for the factor of choleskyDecompose.
+void choleskySolve(const std::vector<double> &l, const size_t n, std::vector<double> &b);
+
+// Solution of the normal equations with the same bounded solver as fitLinear,
+// throws my_error if the equations of the free parameters are singular.
+LinearFit solveNormalEquations(const NormalEquations &ne,
+                               const std::map<size_t, ParLimits> &limits = {});
+
+// Recursive least squares on top of a bounded fit: every update costs O(nFree^2), independent of the
+// number of rows seen. It starts from the parameters and covariance of fit, parameters sitting on a limit
+// stay fixed. A free parameter pushed out of its box by an update is fixed on the limit and the others
+// are moved to the constrained optimum, such a parameter is not released again.
+// forgetting < 1 discounts old rows exponentially, 1 weights all rows equally.
+class RecursiveLeastSquares
+{
+public:
+    RecursiveLeastSquares(const LinearFit &fit,
+                          const std::map<size_t, ParLimits> &limits = {},
+                          const double forgetting = 1.0);
+
+    // x has one entry per parameter, the intercept column included.
+    double predict(const double *x) const;
+    void update(const double *x, const double y, const double w);
+    const std::vector<double> &par() const
+    {
+        return _par;
+    }
+    size_t updates() const
+    {
+        return _updates;
+    }
+private:
+    void fix(const size_t m, const double value);
+
+    std::vector<double> _par;
+    std::vector<size_t> _free;
+    std::vector<double> _p; // inverse information of the free parameters, nFree x nFree, row-major
+    std::map<size_t, ParLimits> _limits;
+    double _forgetting;
+    size_t _updates{0};
+};
+
+#endif // LSQ_H
@@ -5,100 +5,42 @@
 #include <map>
 #include <algorithm>
 #include <TGraphErrors.h>
-#include <TCanvas.h>
 #include <TF1.h>
 #include <optional>
 #include <exception>
 #include <TVirtualFitter.h>
-#include <TLatex.h>
+#include <TFitResult.h>
 #include <numeric>
-#include <TH2.h>
-#include <TLine.h>
-#include <TMarker.h>
 
 #include <bits/stdc++.h>
 
 #include <regex>
 
-class my_error: public std::exception
-{
-public:
-    my_error(const std::string& message) : _message{message}
-    {}
-    const char* what() const noexcept override
-    {
-        return _message.c_str();
-    }
-private:
-    std::string _message;
-};
-
-
-struct FitResult {
-    std::string e;
-    double value;
-    double valueError;
-    void print() const {
-        std::cout << e << " " << value << "\u00B1" << valueError << " ";
-    }
-};
-
-struct ChemResult {
-    enum class Value {
-        A,
-        W
-    };
-    std::optional<double> a;
-    std::optional<double> w;
-    void print() const {
-        auto a{this->a.has_value() ?  this->a.value() : -1};
-        auto w{this->w.has_value() ?  this->w.value() : -1};
-        std::cout << a << " " << w;
-    }
-};
-
-struct Data1 {
-    enum class Value {
-        A,
-        W
-    };
-    ChemResult chem;
-    std::vector<std::vector<FitResult>> fr;
-    void print() const {
-        auto a{this->chem.a.has_value() ?  this->chem.a.value() : -1};
-        auto w{this->chem.w.has_value() ?  this->chem.w.value() : -1};
-        std::cout << a << " " << w << " ";
-        for (const auto& eItem : this->fr)
-        {
-            for (const auto& eItemItem : eItem)
-            {
-                eItemItem.print();
-            }
-        }
-    }
-};
-
-class FitFunction_2
-{
-public:
-    FitFunction_2(std::map<int, std::vector<FitResult>> fR) : _fR{fR} {}
-
-    double operator() (double *x, double *par)
-    {
-        double arg{x[0]};
-        int idx{ std::min(static_cast<int>(std::round(arg)), static_cast<int>(_fR.size() - 1)) };
-        const auto nPar{_fR.begin()->second.size()};
-        double val{0.0};
-        for (size_t i{0}; i < nPar; ++i)
-        {
-            val += par[i] * _fR.at(idx).at(i).value;
-        }
-        val += par[nPar];
-        return val;
-    }
-private:
-    std::map<int, std::vector<FitResult>> _fR;
-};
+#include "bootstrap.h"
+#include "common.h"
+#include "dataset.h"
+#include "fitfunction.h"
+#include "gradientfit.h"
+#include "groupstats.h"
+#include "influence.h"
+#include "ingest.h"
+#include "instrument.h"
+#include "jobs.h"
+#include "lsq.h"
+#include "model.h"
+#include "multistart.h"
+#include "multitarget.h"
+#include "options.h"
+#include "outofcore.h"
+#include "parser.h"
+#include "predict.h"
+#include "render.h"
+#include "repeatability.h"
+#include "report.h"
+#include "selection.h"
+#include "stream.h"
+#include "tablecache.h"
+#include "validation.h"
 
 struct Points {
     std::vector<std::string> l;
@@ -108,32 +50,53 @@ struct Points {
     std::vector<double> yErr;
 };
 
-std::vector<std::string> splitLineToStrs(const std::string &line);
-
-double strToDouble(std::string str);
-
-
-
-std::map<std::string, Data1> getFitResults(const std::string &fileName,
-                                           const std::map<int, std::string> &columnElement,
-                                           const std::map<std::string, ChemResult> &chem,
-                                           const std::regex &pattern);
-
-std::map<int, std::vector<FitResult>> getFitResultsByValue(const std::map<std::string, Data1> &data,
-                                                           const Data1::Value value);
-
-void addPointsByValue(const std::map<std::string, Data1> &data,
+void addPointsByValue(const Dataset &data,
+                      const std::vector<size_t> &rows,
                       Points &points,
                       const Data1::Value value);
 
-void calcRep(const std::map<std::string, Data1> &data,
-             const std::unique_ptr<TF1> &f);
-
-void calcConv(const std::map<std::string, Data1> &data,
-              const std::unique_ptr<TF1> &f,
-              const Data1::Value value);
-
-int main()
+LinearFit fitLinearByValue(const Dataset &data,
+                           const std::vector<size_t> &rows,
+                           const Points &points,
+                           const std::map<size_t, ParLimits> &limits);
+
+LinearFit fitGradientByValue(const Dataset &data,
+                             const std::vector<size_t> &rows,
+                             const Points &points,
+                             const std::map<size_t, ParLimits> &limits);
+
+// Parameters of f in the order of predictBatch: elements, then the intercept.
+std::vector<double> getParameters(const std::unique_ptr<TF1> &f);
+
+// Limits given as "El=lower:upper", "const=lower:upper" for the intercept, by parameter index in the model of data.
+std::map<size_t, ParLimits> parseLimits(const std::vector<std::string> &items, const Dataset &data);
+
+// The model --save-model writes: fit of target on rows rows of elements, fitted by fitMode on source.
+CalibrationModel makeModel(const std::vector<std::string> &elements,
+                           const Data1::Value target,
+                           const LinearFit &fit,
+                           const size_t rows,
+                           const std::string &fitMode,
+                           const std::string &source);
+
+void setFitParameters(const std::unique_ptr<TF1> &f,
+                      const LinearFit &fit);
+
+// Parameters, chi2 and predictions of fit (named name) against the TF1 fit f.
+void compareFits(const std::string &name,
+                 const LinearFit &fit,
+                 const std::unique_ptr<TF1> &f,
+                 const Dataset &data,
+                 const std::vector<size_t> &rows);
+
+// --report[=dir] writes CSV and JSON of reports, --headless skips the plots,
+// otherwise report i is drawn to psNames[i] by renderer.
+void publishReports(const std::vector<Report> &reports,
+                    const std::vector<std::string> &psNames,
+                    const Options &options,
+                    Renderer &renderer);
+
+int main(int argc, char *argv[])
 {
     std::map<std::string, ChemResult> chemBlind
     {
@@ -225,21 +188,189 @@ int main()
 
     try
     {
+        Options options(argc, argv);
+        // --profile - stage timings and counters printed at exit, --profile=file.json - written to file,
+        // destroyed after the renderer so the plots drawn in the background are included
+        ProfileAtExit profile(options.has("profile"), options.get("profile"));
+        // --render=async - plots are drawn on a background thread while the computation goes on
+        Renderer renderer(!options.has("headless") && options.get("render") == "async");
+        // --groups=pattern,... - report groups as regexes searched in the sample names, the blind series by default
+        const auto groupPatterns{options.getList("groups", blindGroups())};
+        // --filter=x0<2,x2==0,C.err<0.5 - rows failing a condition are dropped while the file is parsed, see rowfilter.h
+        const RowFilter filter(options.getList("filter", {}));
+
+        // --render-from=dir - plots of the reports written by an earlier --report=dir or --headless run
+        if (options.has("render-from"))
+        {
+            const auto dir{options.get("render-from")};
+            renderCalibration(readReport(dir, "calibration"), "output.ps");
+            renderConvergence(readReport(dir, "convergence"), "output_conv.ps");
+            return 0;
+        }
 
         // std::regex p{"_povtor_\\d+\\."};
 //        std::regex m{"\\d+_\\d+\\."};
         std::regex m{"\\d+_\\d\\."};
-        auto data1{getFitResults(fileName, columnElement, chem, m)};
+        std::regex s{"sum"};
+//         std::regex s{"\\d+_\\d+\\."};
+        // rows by the structure of their names (see samplekey.h): m - single-digit replicates of the calibration samples
+        // like the regex m, s - their sums; --match=regex - the key as substring of the name and the regexes above
+        const auto matchMode{options.get("match", "index")};
+        if (matchMode != "index" && matchMode != "regex")
+        {
+            throw my_error("Unknown match mode \"" + matchMode + "\"");
+        }
+        std::optional<SampleIndex> index;
+        if (matchMode == "index")
+        {
+            index.emplace(chem);
+        }
+        const auto mMatch{index ? SampleMatcher(*index, { SampleKind::Grad }) : SampleMatcher(chem, m)};
+        const auto sMatch{index ? SampleMatcher(*index, { SampleKind::Sum }) : SampleMatcher(chem, s)};
+
+        // batch of calibration variants sharing the parsed files: --jobs=file [--out=dir], see jobs.h
+        if (options.has("jobs"))
+        {
+            auto results{runJobs(readJobFile(options.get("jobs")), options.get("out", "."), options.getUInt("threads", 0))};
+            printJobResults(results);
+            return 0;
+        }
+
+        // model selection over all element columns of the file (or the --files set): --select=N [--criterion=cv|aic|bic] [--top=K]
+        if (options.has("select"))
+        {
+            Dataset all;
+            if (options.has("files"))
+            {
+                auto table{readTables(expandFiles(options.getList("files", {})), options.getUInt("threads", 0), options.has("cache"), filter)};
+                all = selectDataset(table, table.elements, mMatch);
+            }
+            else
+            {
+                all = getDataset(fileName, getColumnElement(fileName), mMatch, filter);
+            }
+            auto subsets{searchSubsets(all, Data1::Value::A, options.getUInt("select", 3),
+                                       criterionFromString(options.get("criterion", "cv")), 0.5, options.getUInt("threads", 0))};
+            printSubsets(subsets, all, options.getUInt("top", 20));
+            return 0;
+        }
+
+        const std::map<size_t, ParLimits> parLimits{
+            { 1, { -5.0, 0.0 } },
+            { 5, { 50.0, 150.0 } },
+        };
+
+        // --out-of-core [--files=...] - the calibration of A from the cross-product accumulated while the file
+        // (or the --files set) is streamed, no row is kept, so the history may be larger than the memory
+        if (options.has("out-of-core"))
+        {
+            std::vector<std::string> elements;
+            for (const auto &item : columnElement)
+            {
+                elements.push_back(item.second);
+            }
+            const auto files{options.has("files") ? expandFiles(options.getList("files", {})) : std::vector<std::string>{ fileName }};
+            // the yErr of addPointsByValue
+            auto streamed{calibrateStreamed(files, elements, mMatch, Data1::Value::A, 0.5, parLimits,
+                                            options.getUInt("threads", 0), filter)};
+            streamed.print();
+            filter.print();
+            if (options.has("save-model"))
+            {
+                writeModel(makeModel(elements, Data1::Value::A, streamed.fit, streamed.rows, "out-of-core",
+                                     options.has("files") ? options.get("files") : fileName),
+                           options.get("save-model"));
+                std::cout << "model saved to \"" << options.get("save-model") << "\"" << std::endl;
+            }
+            return 0;
+        }
+        Dataset data1;
+        Dataset data1Sum;
+        if (options.has("files"))
+        {
+            // --files=a.all,dir/*.all - several files merged as one, parsed concurrently; with --cache every
+            // file keeps its own sidecar, so a new file in the set is the only one parsed
+            if (options.has("follow"))
+            {
+                throw my_error("--follow can't be combined with --files, it follows a single file");
+            }
+            std::vector<std::string> elements;
+            for (const auto &item : columnElement)
+            {
+                elements.push_back(item.second);
+            }
+            auto table{readTables(expandFiles(options.getList("files", {})), options.getUInt("threads", 0), options.has("cache"), filter)};
+            data1 = selectDataset(table, elements, mMatch);
+            data1Sum = selectDataset(table, elements, sMatch);
+        }
+        else if (options.has("mmap"))
+        {
+            if (options.has("cache"))
+            {
+                throw my_error("--mmap can't be combined with --cache, the cache is read instead of the file");
+            }
+            auto results{getDatasetsMapped(fileName, columnElement, {mMatch, sMatch}, options.getUInt("threads", 0), filter)};
+            data1 = std::move(results.at(0));
+            data1Sum = std::move(results.at(1));
+        }
+        else if (options.has("cache"))
+        {
+            if (!filter.empty())
+            {
+                throw my_error("--filter can't be combined with --cache, the cache holds every row of the file");
+            }
+            // binary sidecar next to the file, rebuilt when the file changes
+            std::vector<std::string> elements;
+            for (const auto &item : columnElement)
+            {
+                elements.push_back(item.second);
+            }
+            auto table{readTableCached(fileName, elements, options.getUInt("threads", 0))};
+            data1 = selectDataset(table, elements, mMatch);
+            data1Sum = selectDataset(table, elements, sMatch);
+        }
+        else
+        {
+            data1 = getDataset(fileName, columnElement, mMatch, filter);
+            data1Sum = getDataset(fileName, columnElement, sMatch, filter);
+        }
+        filter.print();
+        // parLimits are tuned on A, W is fitted free unless --limits-w=C=-5:0,const=0:20 boxes it
+        const auto wLimits{parseLimits(options.getList("limits-w", {}), data1)};
 
         Points points;
 
         auto value{Data1::Value::A};
 
-        addPointsByValue(data1, points, value);
+        auto rows{data1.rowsWith(value)};
 
-        auto fitResultsByValue{getFitResultsByValue(data1, value)};
+        addPointsByValue(data1, rows, points, value);
 
-        std::cout << fitResultsByValue.size() << std::endl;
+        // --influence - leverage, studentized residuals, Cook's distance and DFBETAS of every row and sample,
+        // --influence=drop - the flagged samples are left out of the calibration,
+        // limits by --cook=, --dfbetas=, --studentized=
+        if (options.has("influence"))
+        {
+            const auto mode{options.get("influence")};
+            if (!mode.empty() && mode != "drop")
+            {
+                throw my_error("Unknown influence mode \"" + mode + "\"");
+            }
+            const InfluenceThresholds thresholds{ options.getDouble("cook", 0.0),
+                                                  options.getDouble("dfbetas", 0.0),
+                                                  options.getDouble("studentized", 3.0) };
+            auto influence{analyzeInfluence(data1, rows, value, parLimits, points.yErr.front(), thresholds,
+                                            options.getUInt("threads", 0))};
+            influence.print(data1);
+            if (mode == "drop")
+            {
+                rows = influence.keptRows();
+                points = Points{};
+                addPointsByValue(data1, rows, points, value);
+            }
+        }
+
+        std::cout << rows.size() << std::endl;
 
         std::unique_ptr<TGraphErrors> gr{new TGraphErrors(static_cast<int>(points.x.size()), &points.x[0], &points.y[0], &points.xErr[0], &points.yErr[0])};
         gr.get()->SetMarkerSize(1.5);
@@ -248,94 +379,175 @@ int main()
         grTitle.append(value == Data1::Value::A ? "A" : "W");
         gr.get()->SetTitle(grTitle.c_str());
 
-        std::vector<TLatex> labels;
+        FitFunction_2 fObj(data1, rows);
+        std::unique_ptr<TF1> f{new TF1("f", fObj, points.x.front(), points.x.back(), static_cast<int>(columnElement.size() + 1))};
 
-        for (size_t i{0}; i < points.x.size(); ++i)
+        for (const auto &item : parLimits)
         {
-            auto pos{points.l.at(i).find_last_of("_")};
-            auto text{points.l.at(i)};
-            if (pos != std::string::npos && pos == points.l.at(i).length() - 1)
-            {
-                text = text.substr(0, pos);
-            }
-            TLatex l(points.x.at(i), points.y.at(i) + 1.25 * points.yErr.at(i), text.c_str());
-            l.SetTextAngle(90);
-            l.SetTextAlign(12);
-            l.SetTextSize(0.02);
-            labels.push_back(l);
+            f.get()->SetParLimits(static_cast<int>(item.first), item.second.lower, item.second.upper);
         }
-
-        FitFunction_2 fObj(fitResultsByValue);
-        std::unique_ptr<TF1> f{new TF1("f", fObj, points.x.front(), points.x.back(), static_cast<int>(columnElement.size() + 1))};
-
-        f.get()->SetParLimits(1, -5.0, 0.0);
-        f.get()->SetParLimits(5, 50.0, 150.0);
         f.get()->SetNpx(10 * static_cast<int>(points.x.size()));
 
-        gr.get()->Fit(f.get(), "R");
-
-        const std::string psName{"output.ps"};
-        std::unique_ptr<TCanvas> c{new TCanvas("c", "c", 1024, 960)};
-        c.get()->Print((psName + '[').c_str());
-        gr.get()->Draw("APL");
-
-        auto useSub{true};
-        if (useSub)
+        // --joint - A and W from one factorization of the design, both convergence reports from one prediction pass
+        if (options.has("joint"))
         {
-            std::map<std::pair<std::string, Color_t>, Points> subPoints{
-                { std::make_pair("coal_blind", kRed), Points() },
-                { std::make_pair("barz_blind", kBlue), Points() },
-                { std::make_pair("bereza_blind", kGreen), Points() },
-                { std::make_pair("other", kBlack), Points() },
-            };
-
+            const std::vector<Data1::Value> targets{Data1::Value::A, Data1::Value::W};
+            auto joint{fitTargets(data1, targets, {parLimits, wLimits}, points.yErr.front())};
+            joint.print();
+            auto predicted{predict(data1Sum, { joint.fits[0].par, joint.fits[1].par })};
+            auto convA{calcConv(data1Sum, predicted[0], Data1::Value::A, joint.fits[0].par, groupPatterns)};
+            auto convW{calcConv(data1Sum, predicted[1], Data1::Value::W, joint.fits[1].par, groupPatterns)};
+            std::vector<size_t> sumRows(data1Sum.rows());
+            std::iota(sumRows.begin(), sumRows.end(), 0);
+            printGroupStats(accumulateGroups(data1Sum, sumRows, groupSamples(data1Sum.samples, groupPatterns), targets, predicted));
+            convA.name = "convergence_A";
+            convW.name = "convergence_W";
+            publishReports({ convA, convW }, { "output_conv_A.ps", "output_conv_W.ps" }, options, renderer);
+            return 0;
+        }
 
-            for (size_t i{0}; i < points.x.size(); ++i)
+        // minuit - TF1 fit, gradient - Minuit through Fit::Fitter with the analytic gradient,
+        // linear - direct least squares, check - all of them, compared to the TF1 fit,
+        // multistart [--starts=32] [--seed=S] [--spread=10] - the best of many gradient fits from spread starts
+        const auto fitMode{options.get("fit", "minuit")};
+        if (fitMode != "minuit" && fitMode != "gradient" && fitMode != "linear" && fitMode != "check" && fitMode != "multistart")
+        {
+            throw my_error("Unknown fit mode \"" + fitMode + "\"");
+        }
+        std::vector<double> cov; // of the parameters f ends up with, for --save-model
+        if (fitMode == "minuit" || fitMode == "check")
+        {
+            StageTimer timer("fit.minuit");
+            auto result{gr.get()->Fit(f.get(), "RS")};
+            if (result.Get() != nullptr)
             {
-                auto isOther{false};
-                for (auto &item : subPoints)
+                const auto nPar{static_cast<unsigned int>(f->GetNpar())};
+                cov.resize(nPar * nPar);
+                for (unsigned int i{0}; i < nPar; ++i)
                 {
-                    if (points.l.at(i).find(item.first.first) != std::string::npos)
+                    for (unsigned int j{0}; j < nPar; ++j)
                     {
-                        TMarker m{points.x.at(i), points.y.at(i), 21};
-                        m.SetMarkerSize(1.5);
-                        m.SetMarkerColor(item.first.second);
-                        m.DrawClone("SAME");
-                        item.second.l.push_back(points.l.at(i));
-                        item.second.x.push_back(points.x.at(i));
-                        item.second.y.push_back(points.y.at(i));
-                        item.second.xErr.push_back(0.1);
-                        item.second.yErr.push_back(0.5);
-
-                        isOther = true;
+                        cov[i * nPar + j] = result->CovMatrix(i, j);
                     }
                 }
-                if (!isOther)
-                {
-                    subPoints.at({"other", kBlack}).l.push_back(points.l.at(i));
-                    subPoints.at({"other", kBlack}).x.push_back(points.x.at(i));
-                    subPoints.at({"other", kBlack}).y.push_back(points.y.at(i));
-                    subPoints.at({"other", kBlack}).xErr.push_back(0.1);
-                    subPoints.at({"other", kBlack}).yErr.push_back(0.5);
-                }
+            }
+        }
+        if (fitMode == "gradient" || fitMode == "check")
+        {
+            auto gradientFit{fitGradientByValue(data1, rows, points, parLimits)};
+            std::cout << "gradient fit: chi2 = " << gradientFit.chi2 << " ndf = " << gradientFit.ndf
+                      << " chi2 evaluations = " << gradientFit.iterations << std::endl;
+            if (fitMode == "check")
+            {
+                compareFits("gradient", gradientFit, f, data1, rows);
+            }
+            else
+            {
+                setFitParameters(f, gradientFit);
+                cov = gradientFit.cov;
+            }
+        }
+        if (fitMode == "multistart")
+        {
+            std::vector<double> w;
+            for (auto yErr : points.yErr)
+            {
+                w.push_back(1.0 / (yErr * yErr));
+            }
+            auto multiStart{fitMultiStart(data1.design(rows), points.y, w, parLimits, options.getUInt("starts", 32),
+                                          options.getUInt("seed", 1), options.getDouble("spread", 10.0), 1e-6,
+                                          options.getUInt("threads", 0))};
+            multiStart.print();
+            setFitParameters(f, multiStart.best);
+            cov = multiStart.best.cov;
+        }
+        if (fitMode == "linear" || fitMode == "check")
+        {
+            auto linearFit{fitLinearByValue(data1, rows, points, parLimits)};
+            linearFit.print();
+            if (fitMode == "check")
+            {
+                compareFits("linear", linearFit, f, data1, rows);
+            }
+            else
+            {
+                setFitParameters(f, linearFit);
+                cov = linearFit.cov;
             }
         }
 
-        for (const auto &item : labels)
+        // --follow [--poll=ms] [--idle=s] [--forget=1] - keep reading rows appended to the file,
+        // predict A and W for every new row and update the calibrations on new reference rows
+        if (options.has("follow"))
         {
-//            item.DrawClone("SAME");
+            std::vector<StreamCalibration> calibrations;
+            for (auto v : {Data1::Value::A, Data1::Value::W})
+            {
+                calibrations.push_back(calibrate(data1, v, v == Data1::Value::A ? parLimits : wLimits, points.yErr.front(), options.getDouble("forget", 1.0)));
+            }
+            followFile(fileName, columnElement, mMatch, calibrations, points.yErr.front(),
+                       options.getUInt("poll", 1000), options.getUInt("idle", 0), filter);
+            return 0;
         }
-        c.get()->Print(psName.c_str());
-        c.get()->Print((psName + ']').c_str());
-        c.get()->Close();
 
-        std::regex s{"sum"};
-//         std::regex s{"\\d+_\\d+\\."};
-        auto data1Sum{getFitResults(fileName, columnElement, chem, s)};
-        calcConv(data1Sum, f, value);
-//        std::regex p{"_povtor_\\d+\\."};
-//        auto data1P{getFitResults(fileName, columnElement, chem, p)};
-//        calcRep(data1P, f);
+        const auto par{getParameters(f)};
+        std::vector<double> parErr;
+        for (size_t i{0}; i < par.size(); ++i)
+        {
+            parErr.push_back(f->GetParError(static_cast<int>(i)));
+        }
+        auto calibration{makeReport("calibration", data1, rows, predict(data1, par), value, par, parErr, groupPatterns)};
+        calibration.chi2 = f->GetChisquare();
+        calibration.ndf = f->GetNDF();
+        publishReports({ calibration }, { "output.ps" }, options, renderer);
+
+        // --save-model=file - the calibration with its covariance for the score target
+        if (options.has("save-model"))
+        {
+            // the parameters f ended up with
+            LinearFit fit;
+            fit.par = par;
+            fit.parErr = parErr;
+            fit.cov = cov;
+            fit.chi2 = calibration.chi2;
+            fit.ndf = calibration.ndf;
+            writeModel(makeModel(data1.elements, value, fit, rows.size(), fitMode,
+                                 options.has("files") ? options.get("files") : fileName),
+                       options.get("save-model"));
+            std::cout << "model saved to \"" << options.get("save-model") << "\"" << std::endl;
+        }
+
+        // --cv or --cv=loso - leave one sample out, --cv=K - K folds of whole samples
+        if (options.has("cv"))
+        {
+            const auto cvMode{options.get("cv")};
+            const auto nFolds{cvMode.empty() || cvMode == "loso" ? 0u : options.getUInt("cv", 0)};
+            auto cv{crossValidate(data1, value, nFolds, parLimits, points.yErr.front(), options.getUInt("threads", 0))};
+            cv.print(data1);
+        }
+        // --bootstrap=N [--seed=S] [--level=0.95] - percentile intervals of the parameters and of the sum predictions
+        if (options.has("bootstrap"))
+        {
+            auto bs{bootstrap(data1, value, options.getUInt("bootstrap", 1000), parLimits, points.yErr.front(), data1Sum,
+                              options.getDouble("level", 0.95), options.getUInt("seed", 1), options.getUInt("threads", 0))};
+            bs.print(data1Sum, value);
+        }
+
+        auto convergence{calcConv(data1Sum, predict(data1Sum, par), value, par, groupPatterns)};
+        publishReports({ convergence }, { "output_conv.ps" }, options, renderer);
+
+        // --rep - repeatability of the "_povtor_N" replicate series predicted by the calibration,
+        // streamed over the file (or the --files set) without keeping the predictions
+        if (options.has("rep"))
+        {
+            std::vector<std::string> elements;
+            for (const auto &item : columnElement)
+            {
+                elements.push_back(item.second);
+            }
+            const auto repFiles{options.has("files") ? expandFiles(options.getList("files", {})) : std::vector<std::string>{ fileName }};
+            streamRepeatability(repFiles, elements, par, options.getUInt("threads", 0), filter).print();
+        }
 
 //        std::string fileNameBlind{"rea.elts.txt.12_w_bereza_w_barz_wo_MgCaFeS.blind"}; // wo_MgCaFeS barz+12+bereza
 
@@ -354,323 +566,171 @@ int main()
     return 0;
 }
 
-void calcConv(const std::map<std::string, Data1> &data,
-              const std::unique_ptr<TF1> &f,
-              const Data1::Value value)
+void publishReports(const std::vector<Report> &reports,
+                    const std::vector<std::string> &psNames,
+                    const Options &options,
+                    Renderer &renderer)
 {
-    Points points;
-    for (auto it{data.begin()}; it != data.end(); ++it)
+    if (options.has("report") || options.has("headless"))
     {
-        for (size_t i{0}; i < it->second.fr.size(); ++i)
-        {
-            std::optional<double> v;
-            switch (value) {
-            case Data1::Value::A:
-                v = (*it).second.chem.a;
-                break;
-            case Data1::Value::W:
-                v = (*it).second.chem.w;
-                break;
-            }
-            if (v.has_value())
-            {
-                auto nPar{f.get()->GetNpar()};
-                auto res{0.0};
-                for (auto pIdx{0}; pIdx < nPar - 1; ++pIdx)
-                {
-                    res += f->GetParameter(pIdx) * it->second.fr.at(i).at(static_cast<unsigned int>(pIdx)).value;
-                }
-                res += f->GetParameter(nPar - 1);
-                points.l.push_back(it->first);
-                points.x.push_back(res);
-                points.y.push_back(v.value());
-                points.xErr.push_back(0.1);
-                points.yErr.push_back(0.5);
-            }
+        const auto dir{options.get("report", ".")};
+        for (const auto &report : reports)
+        {
+            writeReport(report, dir.empty() ? "." : dir);
         }
     }
-    std::vector<double> d2;
-    for (size_t i{0}; i < points.x.size(); ++i)
-    {
-        d2.push_back(std::pow(points.y.at(i) - points.x.at(i), 2));
-    }
-    auto stdAbs{std::sqrt(std::accumulate(d2.begin(), d2.end(), 0.0) / d2.size())};
-    auto avg{std::accumulate(points.x.begin(), points.x.end(), 0.0) / points.x.size()};
-    std::cout << "convergence: " << "avg = " << avg << " stdAbs = " << stdAbs << std::endl;
-
-    std::unique_ptr<TGraphErrors> gr{new TGraphErrors(static_cast<int>(points.x.size()), &points.x[0], &points.y[0], &points.xErr[0], &points.yErr[0])};
-    gr.get()->SetMarkerSize(1.5);
-    gr.get()->SetMarkerStyle(21);
-
-    std::vector<TLatex> labels;
-
-    for (size_t i{0}; i < points.x.size(); ++i)
+    if (options.has("headless"))
     {
-        auto pos{points.l.at(i).find_last_of("_")};
-        auto text{points.l.at(i)};
-        if (pos != std::string::npos && pos == points.l.at(i).length() - 1)
-        {
-            text = text.substr(0, pos);
-        }
-        TLatex l(points.x.at(i), points.y.at(i) + 1.25 * points.yErr.at(i), text.c_str());
-        l.SetTextAngle(90);
-        l.SetTextAlign(12);
-        l.SetTextSize(0.02);
-        labels.push_back(l);
+        return;
     }
-
-    std::stringstream ss;
-    ss.str("");ss.clear();
-    ss << (value == Data1::Value::A ? "Ad" : "Wr")
-       << ": avg = "
-       << avg << "%"
-       << ", stdAbs = "
-       << stdAbs << "%"
-       << ";AGP-K, %;Chem, %";
-
-    std::unique_ptr<TH2D> h2dConv{new TH2D("h2dConv",
-                                           ss.str().c_str(),
-                                           static_cast<int>(points.y.size()),
-                                           0.75 * (*std::min_element(points.y.begin(), points.y.end())),
-                                           1.25 * (*std::max_element(points.y.begin(), points.y.end())),
-                                           static_cast<int>(points.y.size()),
-                                           0.75 * (*std::min_element(points.y.begin(), points.y.end())),
-                                           1.25 * (*std::max_element(points.y.begin(), points.y.end())))};
-    h2dConv->SetStats(0);
-    std::unique_ptr<TLine> lConv{new TLine(0.75 * (*std::min_element(points.y.begin(), points.y.end())),
-                                           0.75 * (*std::min_element(points.y.begin(), points.y.end())),
-                                           1.25 * (*std::max_element(points.y.begin(), points.y.end())),
-                                           1.25 * (*std::max_element(points.y.begin(), points.y.end())))};
-    const std::string psName{"output_conv.ps"};
-    std::unique_ptr<TCanvas> c{new TCanvas("c", "c", 1024, 960)};
-    c.get()->Print((psName + '[').c_str());
-    h2dConv.get()->Draw();
-    gr.get()->Draw("P");
-
-    auto useSub{true};
-    if (useSub)
+    for (size_t i{0}; i < reports.size(); ++i)
     {
-        std::map<std::pair<std::string, Color_t>, Points> subPoints{
-            { std::make_pair("coal_blind", kRed), Points() },
-            { std::make_pair("barz_blind", kBlue), Points() },
-            { std::make_pair("bereza_blind", kGreen), Points() },
-            { std::make_pair("other", kMagenta), Points() },
-        };
-
-
-        for (size_t i{0}; i < points.x.size(); ++i)
+        if (reports[i].name.rfind("calibration", 0) == 0)
         {
-            auto isOther{false};
-            for (auto &item : subPoints)
-            {
-                if (points.l.at(i).find(item.first.first) != std::string::npos)
-                {
-                    TMarker m{points.x.at(i), points.y.at(i), 21};
-                    m.SetMarkerSize(1.5);
-                    m.SetMarkerColor(item.first.second);
-                    m.DrawClone("SAME");
-                    item.second.l.push_back(points.l.at(i));
-                    item.second.x.push_back(points.x.at(i));
-                    item.second.y.push_back(points.y.at(i));
-                    item.second.xErr.push_back(0.1);
-                    item.second.yErr.push_back(0.5);
-
-                    isOther = true;
-                }
-            }
-            if (!isOther)
-            {
-                subPoints.at({"other", kMagenta}).l.push_back(points.l.at(i));
-                subPoints.at({"other", kMagenta}).x.push_back(points.x.at(i));
-                subPoints.at({"other", kMagenta}).y.push_back(points.y.at(i));
-                subPoints.at({"other", kMagenta}).xErr.push_back(0.1);
-                subPoints.at({"other", kMagenta}).yErr.push_back(0.5);
-            }
+            renderer.calibration(reports[i], psNames[i]);
         }
-        std::stringstream ss;
-        ss.str("");ss.clear();
-        ss << (value == Data1::Value::A ? "Ad" : "Wr");
-        ss << ": stdAbs=" << std::setprecision(3);
-        auto stdAbs1 = [](Points points){
-            std::vector<double> d2;
-            for (size_t i{0}; i < points.x.size(); ++i)
-            {
-                d2.push_back(std::pow(points.y.at(i) - points.x.at(i), 2));
-            }
-            return std::sqrt(std::accumulate(d2.begin(), d2.end(), 0.0) / static_cast<double>(d2.size()));
-        };
-//        auto avg1 = [](Points points){
-//            return std::accumulate(points.x.begin(), points.x.end(), 0.0) / points.x.size();
-//        };
-        for (auto item : subPoints)
+        else
         {
-            ss << "[#color[" << static_cast<int>(item.first.second) << "]{" << stdAbs1(item.second) << "}] ";
+            renderer.convergence(reports[i], psNames[i]);
         }
-
-        ss << ";AGP-K, %;Chem, %";
-        h2dConv.get()->SetTitle(ss.str().c_str());
     }
+}
 
-    lConv.get()->Draw("SAME");
-    for (const auto &item : labels)
+void addPointsByValue(const Dataset &data,
+                      const std::vector<size_t> &rows,
+                      Points &points,
+                      const Data1::Value value)
+{
+    int xx{0};
+    for (auto row : rows)
     {
-//        item.DrawClone("SAME");
+        auto v{data.reference(row, value)};
+        if (v.has_value())
+        {
+            points.l.push_back(data.samples[data.rowSample[row]] + "_" + std::to_string(data.indexInSample(row)));
+            points.x.push_back(xx++);
+            points.xErr.push_back(0.01);
+            points.y.push_back(v.value());
+            points.yErr.push_back(0.5);
+        }
     }
-    c.get()->Print(psName.c_str());
-    c.get()->Print((psName + ']').c_str());
-    c.get()->Close();
 }
 
-void calcRep(const std::map<std::string, Data1> &data,
-             const std::unique_ptr<TF1> &f)
+LinearFit fitLinearByValue(const Dataset &data,
+                           const std::vector<size_t> &rows,
+                           const Points &points,
+                           const std::map<size_t, ParLimits> &limits)
 {
-
-    std::vector<double> r;
-    for (auto it{data.begin()}; it != data.end(); ++it)
+    StageTimer timer("fit.linear");
+    std::vector<double> w;
+    for (auto yErr : points.yErr)
     {
-        std::cout << (*it).first << " " << it->second.fr.size() << std::endl;
-        for (size_t i{0}; i < it->second.fr.size(); ++i)
-        {
-            auto nPar{f.get()->GetNpar()};
-            auto res{0.0};
-            for (auto pIdx{0}; pIdx < nPar - 1; ++pIdx)
-            {
-                res += f->GetParameter(pIdx) * it->second.fr.at(i).at(static_cast<unsigned int>(pIdx)).value;
-            }
-            res += f->GetParameter(nPar - 1);
-            r.push_back(res);
-        }
+        w.push_back(1.0 / (yErr * yErr));
     }
-    auto avg{std::accumulate(r.begin(), r.end(), 0.0) / r.size()};
-    auto stdAbs{TMath::RMS(r.begin(), r.end())};
-    std::cout << "repeatability: " << "avg = " << avg << " stdAbs = " << stdAbs << std::endl;
+    return fitLinear(data.design(rows), points.y, w, limits);
 }
 
-std::map<std::string, Data1> getFitResults(const std::string &fileName,
-                   const std::map<int, std::string> &columnElement,
-                   const std::map<std::string, ChemResult> &chem,
-                   const std::regex &pattern)
+LinearFit fitGradientByValue(const Dataset &data,
+                             const std::vector<size_t> &rows,
+                             const Points &points,
+                             const std::map<size_t, ParLimits> &limits)
 {
-    std::ifstream ifs(fileName);
-    if (!ifs.is_open())
+    StageTimer timer("fit.gradient");
+    std::vector<double> w;
+    for (auto yErr : points.yErr)
     {
-        throw my_error("Can't open file \"" + fileName + "\"");
+        w.push_back(1.0 / (yErr * yErr));
     }
-    std::string line;
+    return fitGradient(data.design(rows), points.y, w, limits);
+}
 
-    std::map<std::string, Data1> data;
+std::vector<double> getParameters(const std::unique_ptr<TF1> &f)
+{
+    const auto *par{f->GetParameters()};
+    return std::vector<double>(par, par + f->GetNpar());
+}
 
-    while (getline(ifs, line))
+std::map<size_t, ParLimits> parseLimits(const std::vector<std::string> &items, const Dataset &data)
+{
+    std::map<size_t, ParLimits> limits;
+    for (const auto &item : items)
     {
-        auto strs{splitLineToStrs(line)};
-        try
+        const auto eq{item.find('=')};
+        const auto colon{item.find(':', eq == std::string::npos ? 0 : eq)};
+        if (eq == std::string::npos || colon == std::string::npos)
         {
-            auto it = std::find_if(chem.begin(), chem.end(), [&strs, &pattern] (std::pair<std::string, ChemResult> chemItem){
-                return strs.at(0).find(chemItem.first) != std::string::npos && std::regex_search(strs.at(0), pattern);
-            });
-
-            if (it != chem.end())
-            {
-                std::cout << strs.at(0) << std::endl;
-                std::vector<FitResult> fR;
-                for (const auto &item : columnElement)
-                {
-                    fR.push_back({ item.second, strToDouble(strs.at(static_cast<unsigned int>(item.first))),
-                                   strToDouble(strs.at(static_cast<unsigned int>(item.first + 1))) });
-                }
-                data[(*it).first].chem.a = it->second.a;
-                data[(*it).first].chem.w = it->second.w;
-                data[(*it).first].fr.push_back(fR);
-            }
-        }  catch (...) {
-            std::cout << "Error adding e to data";
+            throw my_error("Limit \"" + item + "\" is not \"El=lower:upper\"");
         }
+        const auto name{item.substr(0, eq)};
+        const auto index{name == "const" ? data.elements.size() : data.elementIndex(name)};
+        const ParLimits l{ strToDouble(item.substr(eq + 1, colon - eq - 1)), strToDouble(item.substr(colon + 1)) };
+        if (l.lower > l.upper)
+        {
+            throw my_error("Limit \"" + item + "\": lower above upper");
+        }
+        limits[index] = l;
     }
-    ifs.close();
-    return data;
+    return limits;
 }
 
-std::vector<std::string>splitLineToStrs(const std::string &line)
+CalibrationModel makeModel(const std::vector<std::string> &elements,
+                           const Data1::Value target,
+                           const LinearFit &fit,
+                           const size_t rows,
+                           const std::string &fitMode,
+                           const std::string &source)
 {
-    std::stringstream ss(line);
-    std::string str;
-    std::vector<std::string> strs;
-    while (ss >> str)
-    {
-        strs.push_back(str);
-    }
-    return strs;
-
+    CalibrationModel model;
+    model.target = target;
+    model.elements = elements;
+    model.par = fit.par;
+    model.parErr = fit.parErr;
+    model.cov = fit.cov;
+    model.chi2 = fit.chi2;
+    model.ndf = fit.ndf;
+    model.rows = rows;
+    model.fit = fitMode;
+    model.source = source;
+    return model;
 }
 
-double strToDouble(std::string str)
+void setFitParameters(const std::unique_ptr<TF1> &f,
+                      const LinearFit &fit)
 {
-    double d;
-    std::stringstream ss(str);
-    ss >> d;
-    if (ss.fail())
+    for (size_t i{0}; i < fit.par.size(); ++i)
     {
-        throw my_error("Can\'t convert: " + str);
+        f->SetParameter(static_cast<int>(i), fit.par[i]);
+        f->SetParError(static_cast<int>(i), fit.parErr[i]);
     }
-    return d;
+    f->SetChisquare(fit.chi2);
+    f->SetNDF(fit.ndf);
 }
 
-std::map<int, std::vector<FitResult>> getFitResultsByValue(const std::map<std::string, Data1> &data,
-                                                           const Data1::Value value)
+void compareFits(const std::string &name,
+                 const LinearFit &fit,
+                 const std::unique_ptr<TF1> &f,
+                 const Dataset &data,
+                 const std::vector<size_t> &rows)
 {
-    std::map<int, std::vector<FitResult>> fitResultsByValue;
-    int xx{0};
-    for (auto it{data.begin()}; it != data.end(); ++it)
+    std::cout << name << " vs minuit:" << std::endl;
+    for (size_t i{0}; i < fit.par.size(); ++i)
     {
-        for (size_t i{0}; i < it->second.fr.size(); ++i)
-        {
-            std::string label{it->first + "_" + i};
-            std::optional<double> v;
-            switch (value) {
-            case Data1::Value::A:
-                v = (*it).second.chem.a;
-                break;
-            case Data1::Value::W:
-                v = (*it).second.chem.w;
-                break;
-            }
-            if (v.has_value())
-            {
-                fitResultsByValue[xx++].assign(it->second.fr.at(i).begin(), it->second.fr.at(i).end());
-            }
-        }
+        std::cout << "p" << i << ": " << fit.par[i] << " vs " << f->GetParameter(static_cast<int>(i))
+                  << ", err " << fit.parErr[i] << " vs " << f->GetParError(static_cast<int>(i)) << std::endl;
     }
-    return fitResultsByValue;
-}
-
-void addPointsByValue(const std::map<std::string, Data1> &data,
-                        Points &points,
-                        const Data1::Value value)
-{
-    int xx{0};
-    for (auto it{data.begin()}; it != data.end(); ++it)
+    std::cout << "chi2: " << fit.chi2 << " vs " << f->GetChisquare() << std::endl;
+    // element columns are close to collinear, so compare predictions rather than parameters only
+    const auto nElements{data.elements.size()};
+    auto maxDiff{0.0};
+    for (auto row : rows)
     {
-        for (size_t i{0}; i < it->second.fr.size(); ++i)
-        {
-            std::string label{it->first + "_" + i};
-            std::optional<double> v;
-            switch (value) {
-            case Data1::Value::A:
-                v = (*it).second.chem.a;
-                break;
-            case Data1::Value::W:
-                v = (*it).second.chem.w;
-                break;
-            }
-            if (v.has_value())
-            {
-                points.l.push_back(label);
-                points.x.push_back(xx++);
-                points.xErr.push_back(0.01);
-                points.y.push_back(v.value());
-                points.yErr.push_back(0.5);
-            }
+        auto diff{0.0};
+        for (size_t e{0}; e < nElements; ++e)
+        {
+            diff += (fit.par[e] - f->GetParameter(static_cast<int>(e))) * data.values[e][row];
         }
-
+        diff += fit.par.back() - f->GetParameter(static_cast<int>(nElements));
+        maxDiff = std::max(maxDiff, std::abs(diff));
     }
+    std::cout << "max prediction difference: " << maxDiff << std::endl;
 }
@@ -0,0 +1,46 @@
+#include "mappedfile.h"
+#include "common.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &fileName)
+{
+    auto fd{::open(fileName.c_str(), O_RDONLY)};
+    if (fd < 0)
+    {
+        throw my_error("Can't open file \"" + fileName + "\"");
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw my_error("Can't stat file \"" + fileName + "\": " + std::strerror(errno));
+    }
+    _size = static_cast<size_t>(st.st_size);
+    if (_size > 0)
+    {
+        auto *p{::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0)};
+        if (p == MAP_FAILED)
+        {
+            ::close(fd);
+            throw my_error("Can't map file \"" + fileName + "\": " + std::strerror(errno));
+        }
+        ::madvise(p, _size, MADV_SEQUENTIAL);
+        _data = static_cast<const char *>(p);
+    }
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data)
+    {
+        ::munmap(const_cast<char *>(_data), _size);
+    }
+}
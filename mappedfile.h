@@ -0,0 +1,29 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file, unmapped on destruction.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &fileName);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    std::string_view data() const
+    {
+        return { _data, _size };
+    }
+    size_t size() const
+    {
+        return _size;
+    }
+private:
+    const char *_data{nullptr};
+    size_t _size{0};
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,191 @@
+#include "model.h"
+#include "parser.h"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+namespace {
+
+const char modelMagic[]{"multipar-model"};
+
+void writeValues(std::ostream &os, const std::string &key, const std::vector<double> &values)
+{
+    os << key;
+    for (auto v : values)
+    {
+        os << " " << v;
+    }
+    os << "\n";
+}
+
+// Numbers of the fields after the key.
+std::vector<double> readValues(const std::vector<std::string_view> &strs, const size_t lineNumber)
+{
+    std::vector<double> values;
+    values.reserve(strs.size() - 1);
+    for (size_t i{1}; i < strs.size(); ++i)
+    {
+        values.push_back(columnToDouble(strs, i, lineNumber));
+    }
+    return values;
+}
+
+}
+
+void CalibrationModel::check() const
+{
+    const auto nPar{elements.size() + 1};
+    if (par.size() != nPar || parErr.size() != nPar || (!cov.empty() && cov.size() != nPar * nPar))
+    {
+        throw my_error("Calibration model: " + std::to_string(par.size()) + " parameters, " + std::to_string(parErr.size())
+                       + " errors and " + std::to_string(cov.size()) + " covariance entries for "
+                       + std::to_string(elements.size()) + " elements");
+    }
+}
+
+void writeModel(const CalibrationModel &model, const std::string &fileName)
+{
+    model.check();
+    std::ofstream ofs(fileName);
+    if (!ofs.is_open())
+    {
+        throw my_error("Can't open file \"" + fileName + "\"");
+    }
+    ofs.precision(std::numeric_limits<double>::max_digits10);
+    ofs << modelMagic << " " << modelVersion << "\n";
+    ofs << "target " << (model.target == Data1::Value::A ? "A" : "W") << "\n";
+    ofs << "elements";
+    for (const auto &e : model.elements)
+    {
+        ofs << " " << e;
+    }
+    ofs << "\n";
+    writeValues(ofs, "par", model.par);
+    writeValues(ofs, "parErr", model.parErr);
+    writeValues(ofs, "cov", model.cov);
+    ofs << "chi2 " << model.chi2 << "\n";
+    ofs << "ndf " << model.ndf << "\n";
+    ofs << "rows " << model.rows << "\n";
+    ofs << "fit " << model.fit << "\n";
+    ofs << "source " << model.source << "\n";
+    if (!ofs)
+    {
+        throw my_error("Can't write model \"" + fileName + "\"");
+    }
+}
+
+CalibrationModel readModel(const std::string &fileName)
+{
+    std::ifstream ifs(fileName);
+    if (!ifs.is_open())
+    {
+        throw my_error("Can't open file \"" + fileName + "\"");
+    }
+    std::string line;
+    std::vector<std::string_view> strs;
+    size_t lineNumber{0};
+    if (getline(ifs, line))
+    {
+        ++lineNumber;
+    }
+    if (lineNumber == 0 || splitLineToViews(line, strs) != 2 || strs.front() != modelMagic)
+    {
+        throw my_error("\"" + fileName + "\" is not a calibration model");
+    }
+    const auto version{static_cast<int>(columnToDouble(strs, 1, lineNumber))};
+    if (version < 1 || version > modelVersion)
+    {
+        throw my_error("Calibration model \"" + fileName + "\" has version " + std::to_string(version)
+                       + ", this build reads up to " + std::to_string(modelVersion));
+    }
+
+    CalibrationModel model;
+    std::vector<std::string> keys;
+    while (getline(ifs, line))
+    {
+        ++lineNumber;
+        if (splitLineToViews(line, strs) == 0)
+        {
+            continue;
+        }
+        const std::string key{strs.front()};
+        keys.push_back(key);
+        if (key == "target")
+        {
+            if (strs.size() != 2 || (strs[1] != "A" && strs[1] != "W"))
+            {
+                throw my_error("Calibration model \"" + fileName + "\": bad target in line " + std::to_string(lineNumber));
+            }
+            model.target = strs[1] == "A" ? Data1::Value::A : Data1::Value::W;
+        }
+        else if (key == "elements")
+        {
+            model.elements.assign(strs.begin() + 1, strs.end());
+        }
+        else if (key == "par")
+        {
+            model.par = readValues(strs, lineNumber);
+        }
+        else if (key == "parErr")
+        {
+            model.parErr = readValues(strs, lineNumber);
+        }
+        else if (key == "cov")
+        {
+            model.cov = readValues(strs, lineNumber);
+        }
+        else if (key == "chi2")
+        {
+            model.chi2 = columnToDouble(strs, 1, lineNumber);
+        }
+        else if (key == "ndf")
+        {
+            model.ndf = static_cast<int>(columnToDouble(strs, 1, lineNumber));
+        }
+        else if (key == "rows")
+        {
+            model.rows = static_cast<size_t>(columnToDouble(strs, 1, lineNumber));
+        }
+        else if (key == "fit" || key == "source")
+        {
+            // the rest of the line as written, it may hold spaces
+            const auto pos{line.find_first_not_of(" \t", line.find(key) + key.size())};
+            auto &text{key == "fit" ? model.fit : model.source};
+            text = pos == std::string::npos ? std::string{} : line.substr(pos);
+            text.erase(text.find_last_not_of(" \t\r") + 1);
+        }
+        // keys of later versions are left to them
+    }
+    for (const auto *key : {"target", "elements", "par", "parErr"})
+    {
+        if (std::find(keys.begin(), keys.end(), key) == keys.end())
+        {
+            throw my_error("Calibration model \"" + fileName + "\" lacks \"" + key + "\"");
+        }
+    }
+    model.check();
+    return model;
+}
+
+std::vector<size_t> modelColumns(const CalibrationModel &model,
+                                 const std::map<int, std::string> &columnElement,
+                                 const std::string &source)
+{
+    std::vector<size_t> columns;
+    columns.reserve(model.elements.size());
+    for (const auto &e : model.elements)
+    {
+        auto it{columnElement.begin()};
+        while (it != columnElement.end() && it->second != e)
+        {
+            ++it;
+        }
+        if (it == columnElement.end())
+        {
+            throw my_error("No element " + e + " of the model in \"" + source + "\"");
+        }
+        columns.push_back(static_cast<size_t>(it->first));
+    }
+    return columns;
+}
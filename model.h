@@ -0,0 +1,44 @@
+#ifndef MODEL_H
+#define MODEL_H
+
+#include "common.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// A fitted calibration as saved by multipar --save-model and scored by the score target.
+// par holds one parameter per element, in the order of elements, and the intercept last,
+// the columns of Dataset::design.
+struct CalibrationModel {
+    Data1::Value target{Data1::Value::A};
+    std::vector<std::string> elements;
+    std::vector<double> par;
+    std::vector<double> parErr;
+    std::vector<double> cov; // nPar x nPar, row-major, empty if the fit gave none
+    double chi2{0.0};
+    int ndf{0};
+    size_t rows{0};     // rows of the fit
+    std::string fit;    // fit mode
+    std::string source; // data the model was fitted on
+
+    // Throws my_error if the sizes of the parameters, errors and covariance don't match the elements.
+    void check() const;
+};
+
+// Version written by writeModel, readModel refuses newer files.
+const int modelVersion{1};
+
+// Text file of "key values..." lines after the line "multipar-model <version>", numbers in full precision.
+void writeModel(const CalibrationModel &model, const std::string &fileName);
+
+// Throws my_error if the file can't be read, is not a model or a key is missing.
+CalibrationModel readModel(const std::string &fileName);
+
+// Columns of the model elements in the lines of an input with the header columnElement, in the order of
+// model.elements. Throws my_error naming source if an element is missing.
+std::vector<size_t> modelColumns(const CalibrationModel &model,
+                                 const std::map<int, std::string> &columnElement,
+                                 const std::string &source);
+
+#endif // MODEL_H
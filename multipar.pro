@@ -1,10 +1,10 @@
 TEMPLATE = app
-CONFIG += console c++17
-CONFIG -= app_bundle
-CONFIG -= qt
 
-INCLUDEPATH += $$system(root-config --incdir)
-LIBS += $$system(root-config --libs) -lMinuit -lSpectrum -lMathCore
+include(multipar_core.pri)
 
 SOURCES += \
-        main.cpp
+        main.cpp \
+        render.cpp
+
+HEADERS += \
+        render.h
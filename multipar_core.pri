@@ -0,0 +1,70 @@
+# Sources shared by multipar and the benchmark, everything but the program entry points.
+CONFIG += console c++17
+CONFIG -= app_bundle
+CONFIG -= qt
+
+INCLUDEPATH += $$system(root-config --incdir)
+LIBS += $$system(root-config --libs) -lMinuit -lMinuit2 -lSpectrum -lMathCore
+LIBS += -pthread
+
+# qmake CONFIG+=no_instrument compiles out the stage timers and counters of instrument.h
+no_instrument: DEFINES += MULTIPAR_NO_INSTRUMENT
+
+SOURCES += \
+        $$PWD/bootstrap.cpp \
+        $$PWD/dataset.cpp \
+        $$PWD/gradientfit.cpp \
+        $$PWD/groupstats.cpp \
+        $$PWD/influence.cpp \
+        $$PWD/ingest.cpp \
+        $$PWD/instrument.cpp \
+        $$PWD/jobs.cpp \
+        $$PWD/lsq.cpp \
+        $$PWD/mappedfile.cpp \
+        $$PWD/model.cpp \
+        $$PWD/multistart.cpp \
+        $$PWD/multitarget.cpp \
+        $$PWD/options.cpp \
+        $$PWD/outofcore.cpp \
+        $$PWD/parser.cpp \
+        $$PWD/predict.cpp \
+        $$PWD/repeatability.cpp \
+        $$PWD/report.cpp \
+        $$PWD/rowfilter.cpp \
+        $$PWD/samplekey.cpp \
+        $$PWD/selection.cpp \
+        $$PWD/stream.cpp \
+        $$PWD/tablecache.cpp \
+        $$PWD/tailreader.cpp \
+        $$PWD/validation.cpp
+
+HEADERS += \
+        $$PWD/bootstrap.h \
+        $$PWD/common.h \
+        $$PWD/dataset.h \
+        $$PWD/fitfunction.h \
+        $$PWD/gradientfit.h \
+        $$PWD/groupstats.h \
+        $$PWD/influence.h \
+        $$PWD/ingest.h \
+        $$PWD/instrument.h \
+        $$PWD/jobs.h \
+        $$PWD/lsq.h \
+        $$PWD/mappedfile.h \
+        $$PWD/model.h \
+        $$PWD/multistart.h \
+        $$PWD/multitarget.h \
+        $$PWD/options.h \
+        $$PWD/outofcore.h \
+        $$PWD/parser.h \
+        $$PWD/predict.h \
+        $$PWD/repeatability.h \
+        $$PWD/report.h \
+        $$PWD/rowfilter.h \
+        $$PWD/samplekey.h \
+        $$PWD/selection.h \
+        $$PWD/stream.h \
+        $$PWD/tablecache.h \
+        $$PWD/tailreader.h \
+        $$PWD/threadpool.h \
+        $$PWD/validation.h
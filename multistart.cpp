@@ -0,0 +1,120 @@
+#include "multistart.h"
+#include "common.h"
+#include "gradientfit.h"
+#include "instrument.h"
+#include "threadpool.h"
+
+#include <TROOT.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+void MultiStartResult::print() const
+{
+    std::cout << "multi-start fit: " << chi2.size() << " starts, " << converged << " converged, "
+              << atBest << " at the best chi2 = " << best.chi2 << " (start " << bestStart << ")" << std::endl;
+    best.print();
+}
+
+std::vector<double> startingPoint(const size_t nPar,
+                                  const std::map<size_t, ParLimits> &limits,
+                                  const size_t start,
+                                  const std::uint64_t seed,
+                                  const double spread)
+{
+    std::vector<double> par(nPar, 0.0);
+    if (start == 0)
+    {
+        for (const auto &item : limits)
+        {
+            par[item.first] = std::clamp(0.0, item.second.lower, item.second.upper);
+        }
+        return par;
+    }
+    std::seed_seq seq{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32),
+                      static_cast<std::uint32_t>(start), static_cast<std::uint32_t>(start >> 32)};
+    std::mt19937_64 rng(seq);
+    for (size_t i{0}; i < nPar; ++i)
+    {
+        const auto it{limits.find(i)};
+        std::uniform_real_distribution<double> u(it == limits.end() ? -spread : it->second.lower,
+                                                 it == limits.end() ? spread : it->second.upper);
+        par[i] = u(rng);
+    }
+    return par;
+}
+
+MultiStartResult fitMultiStart(const std::vector<std::vector<double>> &columns,
+                               const std::vector<double> &y,
+                               const std::vector<double> &w,
+                               const std::map<size_t, ParLimits> &limits,
+                               const size_t nStarts,
+                               const std::uint64_t seed,
+                               const double spread,
+                               const double tolerance,
+                               const unsigned int nThreads)
+{
+    if (nStarts == 0)
+    {
+        throw my_error("fitMultiStart: no starts");
+    }
+    for (const auto &item : limits)
+    {
+        if (item.first >= columns.size() || item.second.lower > item.second.upper)
+        {
+            throw my_error("fitMultiStart: bad limits for parameter " + std::to_string(item.first));
+        }
+    }
+    StageTimer timer("fit.multistart");
+    // Minuit2 and the fitters are made per start, ROOT itself has to be told about the threads
+    ROOT::EnableThreadSafety();
+    const LinearChi2 chi2(columns, y, w);
+
+    MultiStartResult result;
+    std::vector<LinearFit> fits(nStarts);
+    result.chi2.assign(nStarts, std::numeric_limits<double>::quiet_NaN());
+    ThreadPool pool(std::min<unsigned int>(defaultThreads(nThreads), static_cast<unsigned int>(nStarts)) - 1);
+    pool.parallelFor(nStarts, [&](size_t i){
+        try
+        {
+            fits[i] = fitGradient(chi2, limits, startingPoint(columns.size(), limits, i, seed, spread), "Minuit2");
+            result.chi2[i] = fits[i].chi2;
+        }
+        catch (const my_error &)
+        {
+            // a failed start only counts as not converged
+        }
+    });
+
+    // the first start with the lowest chi2, so ties go the same way whatever the thread count
+    auto found{false};
+    for (size_t i{0}; i < nStarts; ++i)
+    {
+        if (std::isnan(result.chi2[i]))
+        {
+            continue;
+        }
+        ++result.converged;
+        if (!found || result.chi2[i] < result.chi2[result.bestStart])
+        {
+            result.bestStart = i;
+            found = true;
+        }
+    }
+    if (!found)
+    {
+        throw my_error("fitMultiStart: none of " + std::to_string(nStarts) + " starts converged");
+    }
+    const auto bestChi2{result.chi2[result.bestStart]};
+    for (auto c : result.chi2)
+    {
+        if (!std::isnan(c) && c - bestChi2 <= tolerance * std::max(1.0, bestChi2))
+        {
+            ++result.atBest;
+        }
+    }
+    result.best = std::move(fits[result.bestStart]);
+    return result;
+}
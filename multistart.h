@@ -0,0 +1,42 @@
+#ifndef MULTISTART_H
+#define MULTISTART_H
+
+#include "lsq.h"
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+struct MultiStartResult {
+    LinearFit best;
+    size_t bestStart{0};
+    std::vector<double> chi2; // per start, NaN if Minuit failed
+    size_t converged{0};      // starts Minuit finished
+    size_t atBest{0};         // starts that reached the chi2 of best within the tolerance
+    void print() const;
+};
+
+// Start i of fitMultiStart: start 0 is the start of fitGradient (zeros moved inside the limits),
+// the others draw parameters with limits uniformly inside their box and the rest uniformly
+// from [-spread, spread], from a generator seeded with (seed, i).
+std::vector<double> startingPoint(const size_t nPar,
+                                  const std::map<size_t, ParLimits> &limits,
+                                  const size_t start,
+                                  const std::uint64_t seed,
+                                  const double spread);
+
+// nStarts bounded Migrad fits of the calibration (see fitGradient) from the starting points of
+// startingPoint, run by nThreads workers, every fit with its own Minuit2 minimizer.
+// A start is at the best chi2 if it is within tolerance * max(1, best chi2) of it.
+// The starting points do not depend on nThreads, so neither does the result.
+MultiStartResult fitMultiStart(const std::vector<std::vector<double>> &columns,
+                               const std::vector<double> &y,
+                               const std::vector<double> &w,
+                               const std::map<size_t, ParLimits> &limits,
+                               const size_t nStarts,
+                               const std::uint64_t seed = 1,
+                               const double spread = 10.0,
+                               const double tolerance = 1e-6,
+                               const unsigned int nThreads = 0);
+
+#endif // MULTISTART_H
@@ -0,0 +1,97 @@
+#include "multitarget.h"
+#include "instrument.h"
+
+void MultiTargetFit::print() const
+{
+    std::cout << "joint fit: " << targets.size() << " targets, " << factorizations << " factorizations" << std::endl;
+    for (size_t t{0}; t < targets.size(); ++t)
+    {
+        std::cout << (targets[t] == Data1::Value::A ? "A" : "W") << ", " << rows[t] << " rows, ";
+        fits[t].print();
+    }
+}
+
+MultiTargetFit fitTargets(const Dataset &data,
+                          const std::vector<Data1::Value> &targets,
+                          const std::vector<std::map<size_t, ParLimits>> &limits,
+                          const double yErr)
+{
+    StageTimer timer("fit.joint");
+    if (limits.size() != targets.size())
+    {
+        throw my_error("fitTargets: one limits map per target is needed");
+    }
+    const auto nTargets{targets.size()};
+    const auto nPar{data.elements.size() + 1};
+    const auto w{1.0 / (yErr * yErr)};
+
+    // rows by the set of targets present, as a bit mask
+    std::map<unsigned long, std::vector<size_t>> groups;
+    for (size_t row{0}; row < data.rows(); ++row)
+    {
+        unsigned long mask{0};
+        for (size_t t{0}; t < nTargets; ++t)
+        {
+            if (data.reference(row, targets[t]).has_value())
+            {
+                mask |= 1ul << t;
+            }
+        }
+        if (mask != 0)
+        {
+            groups[mask].push_back(row);
+        }
+    }
+
+    MultiTargetFit result;
+    result.targets = targets;
+    result.rows.assign(nTargets, 0);
+    std::vector<std::vector<std::vector<double>>> columns(nTargets, std::vector<std::vector<double>>(nPar));
+    std::vector<std::vector<double>> y(nTargets);
+    std::vector<double> rss(nTargets, 0.0);
+    for (const auto &group : groups)
+    {
+        std::vector<size_t> present;
+        std::vector<std::vector<double>> ys;
+        for (size_t t{0}; t < nTargets; ++t)
+        {
+            if (group.first & (1ul << t))
+            {
+                present.push_back(t);
+                ys.emplace_back();
+                for (auto row : group.second)
+                {
+                    ys.back().push_back(data.reference(row, targets[t]).value());
+                }
+            }
+        }
+        const auto compressed{compressRows(data.design(group.second), ys, std::vector<double>(group.second.size(), w))};
+        ++result.factorizations;
+        for (size_t i{0}; i < present.size(); ++i)
+        {
+            const auto t{present[i]};
+            for (size_t j{0}; j < nPar; ++j)
+            {
+                columns[t][j].insert(columns[t][j].end(), compressed[i].columns[j].begin(), compressed[i].columns[j].end());
+            }
+            y[t].insert(y[t].end(), compressed[i].y.begin(), compressed[i].y.end());
+            rss[t] += compressed[i].rss;
+            result.rows[t] += group.second.size();
+        }
+    }
+
+    for (size_t t{0}; t < nTargets; ++t)
+    {
+        if (result.rows[t] < nPar)
+        {
+            throw my_error("fitTargets: " + std::to_string(result.rows[t]) + " rows are not enough for "
+                           + std::to_string(nPar) + " parameters");
+        }
+        auto fit{fitLinear(columns[t], y[t], std::vector<double>(y[t].size(), 1.0), limits[t])};
+        // pseudo-rows carry the fit, the residual the model can't explain comes from the factorization
+        fit.chi2 += rss[t];
+        fit.ndf = static_cast<int>(result.rows[t]) - static_cast<int>(nPar);
+        result.fits.push_back(std::move(fit));
+    }
+    return result;
+}
@@ -0,0 +1,28 @@
+#ifndef MULTITARGET_H
+#define MULTITARGET_H
+
+#include "dataset.h"
+#include "lsq.h"
+
+#include <map>
+#include <vector>
+
+struct MultiTargetFit {
+    std::vector<Data1::Value> targets;
+    std::vector<LinearFit> fits;     // per target
+    std::vector<size_t> rows;        // rows with a reference, per target
+    size_t factorizations{0};        // row groups factorized, one per combination of present targets
+    void print() const;
+};
+
+// Calibrations of all targets on the rows of data from one factorization of the design.
+// Rows are grouped by the targets they have a reference for, every group is reduced by QR once
+// with the references of all its targets as right-hand sides (compressRows). Each target is then
+// fitted with its own limits on the pseudo-rows of the groups it is present in, so a row without
+// a reference for a target does not take part in that target's fit.
+MultiTargetFit fitTargets(const Dataset &data,
+                          const std::vector<Data1::Value> &targets,
+                          const std::vector<std::map<size_t, ParLimits>> &limits,
+                          const double yErr);
+
+#endif // MULTITARGET_H
@@ -0,0 +1,105 @@
+#include "options.h"
+#include "common.h"
+
+#include <limits>
+#include <stdexcept>
+
+Options::Options(int argc, char *argv[])
+{
+    for (int i{1}; i < argc; ++i)
+    {
+        std::string arg{argv[i]};
+        if (arg.rfind("--", 0) != 0 || arg.size() == 2)
+        {
+            throw my_error("Unknown argument \"" + arg + "\"");
+        }
+        auto pos{arg.find('=')};
+        if (pos == std::string::npos)
+        {
+            _options[arg.substr(2)] = "";
+        }
+        else
+        {
+            _options[arg.substr(2, pos - 2)] = arg.substr(pos + 1);
+        }
+    }
+}
+
+bool Options::has(const std::string &key) const
+{
+    return _options.find(key) != _options.end();
+}
+
+std::string Options::get(const std::string &key, const std::string &defaultValue) const
+{
+    auto it{_options.find(key)};
+    return it != _options.end() ? it->second : defaultValue;
+}
+
+double Options::getDouble(const std::string &key, const double defaultValue) const
+{
+    auto it{_options.find(key)};
+    if (it == _options.end())
+    {
+        return defaultValue;
+    }
+    try
+    {
+        return std::stod(it->second);
+    }
+    catch (const std::exception &)
+    {
+        throw my_error("Option --" + key + " expects a number, got \"" + it->second + "\"");
+    }
+}
+
+unsigned int Options::getUInt(const std::string &key, const unsigned int defaultValue) const
+{
+    auto it{_options.find(key)};
+    if (it == _options.end())
+    {
+        return defaultValue;
+    }
+    // std::stoul accepts a sign and wraps "-1" around, so only digits are let through
+    const auto &value{it->second};
+    if (!value.empty() && value.find_first_not_of("0123456789") == std::string::npos)
+    {
+        try
+        {
+            const auto v{std::stoul(value)};
+            if (v <= std::numeric_limits<unsigned int>::max())
+            {
+                return static_cast<unsigned int>(v);
+            }
+        }
+        catch (const std::out_of_range &)
+        {
+        }
+    }
+    throw my_error("Option --" + key + " expects a non-negative integer, got \"" + value + "\"");
+}
+
+std::vector<std::string> Options::getList(const std::string &key, const std::vector<std::string> &defaultValue) const
+{
+    auto it{_options.find(key)};
+    if (it == _options.end())
+    {
+        return defaultValue;
+    }
+    std::vector<std::string> list;
+    size_t begin{0};
+    while (begin <= it->second.size())
+    {
+        auto end{it->second.find(',', begin)};
+        if (end == std::string::npos)
+        {
+            end = it->second.size();
+        }
+        if (end > begin)
+        {
+            list.push_back(it->second.substr(begin, end - begin));
+        }
+        begin = end + 1;
+    }
+    return list;
+}
@@ -0,0 +1,24 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Command line in the form "--key=value" or "--flag".
+class Options
+{
+public:
+    Options(int argc, char *argv[]);
+
+    bool has(const std::string &key) const;
+    std::string get(const std::string &key, const std::string &defaultValue = "") const;
+    double getDouble(const std::string &key, const double defaultValue) const;
+    unsigned int getUInt(const std::string &key, const unsigned int defaultValue) const;
+    // Comma-separated values of key, empty items dropped.
+    std::vector<std::string> getList(const std::string &key, const std::vector<std::string> &defaultValue) const;
+private:
+    std::map<std::string, std::string> _options;
+};
+
+#endif // OPTIONS_H
@@ -0,0 +1,219 @@
+#include "outofcore.h"
+#include "dataset.h"
+#include "instrument.h"
+#include "mappedfile.h"
+#include "parser.h"
+#include "threadpool.h"
+
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+// pending rows folded at once, large enough to keep the QR of the pseudo-rows cheap per row
+const size_t blockRows{4096};
+
+}
+
+CalibrationAccumulator::CalibrationAccumulator(const size_t nElements, const size_t nSamples)
+    : _columns(nElements + 1), _sampleRows(nSamples, 0)
+{
+    _compressed.columns.resize(nElements + 1);
+}
+
+void CalibrationAccumulator::add(const size_t sample, const double *x, const double y, const double w)
+{
+    const auto nElements{_columns.size() - 1};
+    for (size_t e{0}; e < nElements; ++e)
+    {
+        _columns[e].push_back(x[e]);
+    }
+    _columns[nElements].push_back(1.0);
+    _y.push_back(y);
+    _w.push_back(w);
+    ++_n;
+    ++_sampleRows[sample];
+    if (_y.size() == blockRows)
+    {
+        fold();
+    }
+}
+
+void CalibrationAccumulator::fold()
+{
+    if (_y.empty())
+    {
+        return;
+    }
+    // the pseudo-rows have unit weight and go first, they are the rows folded before
+    const auto m{_compressed.y.size()};
+    std::vector<double> w(m, 1.0);
+    w.insert(w.end(), _w.begin(), _w.end());
+    for (size_t j{0}; j < _columns.size(); ++j)
+    {
+        _columns[j].insert(_columns[j].begin(), _compressed.columns[j].begin(), _compressed.columns[j].end());
+    }
+    _y.insert(_y.begin(), _compressed.y.begin(), _compressed.y.end());
+    auto c{compressRows(_columns, _y, w)};
+    c.rss += _compressed.rss;
+    _compressed = std::move(c);
+    for (auto &column : _columns)
+    {
+        column.clear();
+    }
+    _y.clear();
+    _w.clear();
+}
+
+CalibrationAccumulator &CalibrationAccumulator::operator+=(const CalibrationAccumulator &other)
+{
+    if (_columns.empty())
+    {
+        return *this = other;
+    }
+    if (other._columns.size() != _columns.size() || other._sampleRows.size() != _sampleRows.size())
+    {
+        throw my_error("CalibrationAccumulator: adding " + std::to_string(other._columns.size() - 1) + " elements and "
+                       + std::to_string(other._sampleRows.size()) + " samples to " + std::to_string(_columns.size() - 1)
+                       + " and " + std::to_string(_sampleRows.size()));
+    }
+    // the pseudo-rows and pending rows of other become pending rows here
+    for (size_t j{0}; j < _columns.size(); ++j)
+    {
+        _columns[j].insert(_columns[j].end(), other._compressed.columns[j].begin(), other._compressed.columns[j].end());
+        _columns[j].insert(_columns[j].end(), other._columns[j].begin(), other._columns[j].end());
+    }
+    _y.insert(_y.end(), other._compressed.y.begin(), other._compressed.y.end());
+    _y.insert(_y.end(), other._y.begin(), other._y.end());
+    _w.insert(_w.end(), other._compressed.y.size(), 1.0);
+    _w.insert(_w.end(), other._w.begin(), other._w.end());
+    _compressed.rss += other._compressed.rss;
+    _n += other._n;
+    for (size_t s{0}; s < _sampleRows.size(); ++s)
+    {
+        _sampleRows[s] += other._sampleRows[s];
+    }
+    fold();
+    return *this;
+}
+
+CompressedRows CalibrationAccumulator::compressed() const
+{
+    auto copy{*this};
+    copy.fold();
+    copy._compressed.n = _n;
+    return copy._compressed;
+}
+
+void StreamedCalibration::print() const
+{
+    std::cout << "streamed calibration: " << rows << " rows" << std::endl;
+    for (size_t s{0}; s < samples.size(); ++s)
+    {
+        if (sampleRows[s] > 0)
+        {
+            std::cout << samples[s] << " " << sampleRows[s] << std::endl;
+        }
+    }
+    fit.print();
+}
+
+StreamedCalibration calibrateStreamed(const std::vector<std::string> &fileNames,
+                                      const std::vector<std::string> &elements,
+                                      const SampleMatcher &matcher,
+                                      const Data1::Value value,
+                                      const double yErr,
+                                      const std::map<size_t, ParLimits> &limits,
+                                      const unsigned int nThreads,
+                                      const RowFilter &filter)
+{
+    StageTimer timer("calibrate.streamed");
+    StreamedCalibration result;
+    result.elements = elements;
+    std::unordered_map<std::string_view, size_t> sampleIndex;
+    for (const auto &item : matcher.chem())
+    {
+        sampleIndex.emplace(item.first, result.samples.size());
+        result.samples.push_back(item.first);
+    }
+    const auto w{1.0 / (yErr * yErr)};
+    const auto threads{defaultThreads(nThreads)};
+    ThreadPool pool(threads - 1);
+    CalibrationAccumulator total(elements.size(), result.samples.size());
+    for (const auto &fileName : fileNames)
+    {
+        // columns of the elements in this file, in the order of elements
+        const auto columnElement{getColumnElement(fileName)};
+        std::vector<size_t> columns;
+        for (const auto &e : elements)
+        {
+            auto it{columnElement.begin()};
+            while (it != columnElement.end() && it->second != e)
+            {
+                ++it;
+            }
+            if (it == columnElement.end())
+            {
+                throw my_error("No element " + e + " of the calibration in \"" + fileName + "\"");
+            }
+            columns.push_back(static_cast<size_t>(it->first));
+        }
+        const auto fileFilter{filter.forColumns(columnElement, fileName)};
+
+        MappedFile file(fileName);
+        const auto chunks{splitTextToChunks(file.data(), chunkCount(file.size(), threads))};
+        std::vector<CalibrationAccumulator> partial(chunks.size(), CalibrationAccumulator(elements.size(), result.samples.size()));
+        std::vector<std::vector<std::string>> errors(chunks.size());
+        scanChunks(chunks, pool, [&](size_t i, size_t lineNumber, const std::vector<std::string_view> &strs){
+            const auto it{matcher.match(strs.front())};
+            if (it == matcher.chem().end())
+            {
+                return;
+            }
+            if (!fileFilter.accept(strs))
+            {
+                return;
+            }
+            const auto reference{getReference(it->second, value)};
+            if (!reference.has_value())
+            {
+                return;
+            }
+            thread_local std::vector<double> x;
+            x.resize(columns.size());
+            try
+            {
+                for (size_t e{0}; e < columns.size(); ++e)
+                {
+                    x[e] = columnToDouble(strs, columns[e], lineNumber);
+                }
+            }
+            catch (const my_error &err)
+            {
+                errors[i].push_back(err.what());
+                return;
+            }
+            partial[i].add(sampleIndex.at(it->first), x.data(), reference.value(), w);
+            countEvent(Counter::LinesMatched);
+        });
+        for (size_t i{0}; i < chunks.size(); ++i)
+        {
+            for (const auto &error : errors[i])
+            {
+                std::cout << "Error: " << error << std::endl;
+            }
+            total += partial[i];
+        }
+    }
+    const auto c{total.compressed()};
+    result.sampleRows = total.sampleRows();
+    result.rows = c.n;
+    if (c.n == 0)
+    {
+        throw my_error("calibrateStreamed: no rows with a reference value");
+    }
+    result.fit = fitLinear(c.columns, c.y, std::vector<double>(c.y.size(), 1.0), limits);
+    result.fit.chi2 += c.rss;
+    result.fit.ndf = static_cast<int>(c.n) - static_cast<int>(elements.size() + 1);
+    return result;
+}
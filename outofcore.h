@@ -0,0 +1,69 @@
+#ifndef OUTOFCORE_H
+#define OUTOFCORE_H
+
+#include "common.h"
+#include "lsq.h"
+#include "rowfilter.h"
+#include "samplekey.h"
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+// Sufficient statistics of a calibration, fed one row at a time: the weighted cross-product of all elements
+// and the intercept with its moment vector, kept factored as the pseudo-rows of compressRows (R^T R = X^T W X,
+// so collinear element columns are solved as fitLinear solves them), and the row count of every reference
+// sample. Rows are folded in blocks, the size depends on the number of elements and samples only.
+// Accumulators of disjoint rows merge by += in any order.
+class CalibrationAccumulator
+{
+public:
+    CalibrationAccumulator() = default;
+    CalibrationAccumulator(const size_t nElements, const size_t nSamples);
+
+    // x holds the values of the elements, the intercept is implicit.
+    void add(const size_t sample, const double *x, const double y, const double w);
+    CalibrationAccumulator &operator+=(const CalibrationAccumulator &other);
+    // All rows so far reduced to at most nElements + 1 pseudo-rows, n is the number of rows.
+    CompressedRows compressed() const;
+    const std::vector<size_t> &sampleRows() const
+    {
+        return _sampleRows;
+    }
+private:
+    // Folds the pending rows into _compressed.
+    void fold();
+
+    CompressedRows _compressed;
+    std::vector<std::vector<double>> _columns; // pending rows, the element columns and the column of ones
+    std::vector<double> _y;
+    std::vector<double> _w;
+    size_t _n{0};
+    std::vector<size_t> _sampleRows;
+};
+
+struct StreamedCalibration {
+    std::vector<std::string> elements;
+    std::vector<std::string> samples; // keys of the reference list
+    std::vector<size_t> sampleRows;   // rows of every sample
+    size_t rows{0};
+    LinearFit fit;
+    void print() const;
+};
+
+// Calibration of value over the rows of fileNames selected by matcher, without keeping the rows: every file
+// is mapped and scanned once by nThreads workers (0 - hardware concurrency) into one accumulator per chunk,
+// the accumulators of all chunks and files are merged and their pseudo-rows fitted by fitLinear with limits.
+// elements are looked up by name in the header of every file, every row has the weight 1 / yErr^2.
+// The fit equals fitLinear of the same rows read into a Dataset up to rounding.
+StreamedCalibration calibrateStreamed(const std::vector<std::string> &fileNames,
+                                      const std::vector<std::string> &elements,
+                                      const SampleMatcher &matcher,
+                                      const Data1::Value value,
+                                      const double yErr,
+                                      const std::map<size_t, ParLimits> &limits = {},
+                                      const unsigned int nThreads = 0,
+                                      const RowFilter &filter = {});
+
+#endif // OUTOFCORE_H
@@ -0,0 +1,437 @@
+#include "parser.h"
+#include "instrument.h"
+#include "mappedfile.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <functional>
+#include <sstream>
+
+std::vector<std::string>splitLineToStrs(const std::string &line)
+{
+    std::stringstream ss(line);
+    std::string str;
+    std::vector<std::string> strs;
+    while (ss >> str)
+    {
+        strs.push_back(str);
+    }
+    return strs;
+
+}
+
+double strToDouble(std::string str)
+{
+    double d;
+    std::stringstream ss(str);
+    ss >> d;
+    if (ss.fail())
+    {
+        throw my_error("Can\'t convert: " + str);
+    }
+    return d;
+}
+
+namespace {
+
+inline bool isSpace(const char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+}
+
+size_t splitLineToViews(std::string_view line, std::vector<std::string_view> &views)
+{
+    views.clear();
+    const auto *p{line.data()};
+    const auto *end{p + line.size()};
+    while (p != end)
+    {
+        while (p != end && isSpace(*p))
+        {
+            ++p;
+        }
+        const auto *begin{p};
+        while (p != end && !isSpace(*p))
+        {
+            ++p;
+        }
+        if (p != begin)
+        {
+            views.emplace_back(begin, static_cast<size_t>(p - begin));
+        }
+    }
+    return views.size();
+}
+
+size_t splitSampleName(std::string_view name, std::vector<std::string_view> &parts)
+{
+    parts.clear();
+    while (!name.empty())
+    {
+        auto pos{name.find_first_of("_.")};
+        auto part{name.substr(0, pos)};
+        if (!part.empty())
+        {
+            parts.push_back(part);
+        }
+        name.remove_prefix(pos == std::string_view::npos ? name.size() : pos + 1);
+    }
+    return parts.size();
+}
+
+double columnToDouble(const std::vector<std::string_view> &strs,
+                      const size_t column,
+                      const size_t lineNumber)
+{
+    if (column >= strs.size())
+    {
+        throw my_error("line " + std::to_string(lineNumber) + ", column " + std::to_string(column) + ": missing value");
+    }
+    auto str{strs[column]};
+    // istream accepts an explicit plus sign, from_chars does not
+    if (str.size() > 1 && str.front() == '+')
+    {
+        str.remove_prefix(1);
+    }
+    double d;
+    const auto *end{str.data() + str.size()};
+    auto [ptr, ec]{std::from_chars(str.data(), end, d)};
+    if (ec != std::errc() || ptr != end)
+    {
+        throw my_error("line " + std::to_string(lineNumber) + ", column " + std::to_string(column)
+                       + ": can\'t convert: " + std::string(strs[column]));
+    }
+    return d;
+}
+
+ChemIterator findChem(std::string_view name,
+                      const std::map<std::string, ChemResult> &chem,
+                      const std::regex &pattern)
+{
+    // the pattern does not depend on the key, so it is checked once and only for names that hit a key
+    auto it{std::find_if(chem.begin(), chem.end(), [&name] (const std::pair<const std::string, ChemResult> &chemItem){
+        return name.find(chemItem.first) != std::string_view::npos;
+    })};
+    if (it == chem.end())
+    {
+        return it;
+    }
+    countEvent(Counter::RegexEvaluations);
+    return std::regex_search(name.begin(), name.end(), pattern) ? it : chem.end();
+}
+
+void getValuesFromLine(const std::vector<std::string_view> &strs,
+                       const std::map<int, std::string> &columnElement,
+                       const size_t lineNumber,
+                       std::vector<double> &values)
+{
+    values.clear();
+    for (const auto &item : columnElement)
+    {
+        const auto column{static_cast<size_t>(item.first)};
+        values.push_back(columnToDouble(strs, column, lineNumber));
+        values.push_back(columnToDouble(strs, column + 1, lineNumber));
+    }
+}
+
+std::map<int, std::string> getColumnElement(const std::string &fileName)
+{
+    std::ifstream ifs(fileName);
+    if (!ifs.is_open())
+    {
+        throw my_error("Can't open file \"" + fileName + "\"");
+    }
+    std::string line;
+    std::vector<std::string_view> strs;
+    while (getline(ifs, line) && splitLineToViews(line, strs) == 0)
+    {
+    }
+    return getColumnElement(strs, fileName);
+}
+
+std::map<int, std::string> getColumnElement(const std::vector<std::string_view> &header, const std::string &source)
+{
+    if (header.empty() || header.front() != "fileName")
+    {
+        throw my_error("No \"fileName El err ...\" header in \"" + source + "\"");
+    }
+    std::map<int, std::string> columnElement;
+    for (size_t i{1}; i + 1 < header.size(); ++i)
+    {
+        if (header[i + 1] == "err")
+        {
+            columnElement[static_cast<int>(i)] = std::string(header[i]);
+            ++i;
+        }
+    }
+    return columnElement;
+}
+
+std::vector<FitResult> getFitResultsFromValues(const std::vector<double> &values,
+                                               const std::map<int, std::string> &columnElement)
+{
+    std::vector<FitResult> fR;
+    fR.reserve(columnElement.size());
+    auto v{values.begin()};
+    for (const auto &item : columnElement)
+    {
+        fR.push_back({ item.second, *v, *(v + 1) });
+        v += 2;
+    }
+    return fR;
+}
+
+void parseFile(const std::string &fileName,
+               const std::map<int, std::string> &columnElement,
+               const std::map<std::string, ChemResult> &chem,
+               const std::regex &pattern,
+               const MatchCallback &onMatch,
+               const RowFilter &filter)
+{
+    parseFile(fileName, columnElement, SampleMatcher(chem, pattern), onMatch, filter);
+}
+
+void parseFile(const std::string &fileName,
+               const std::map<int, std::string> &columnElement,
+               const SampleMatcher &matcher,
+               const MatchCallback &onMatch,
+               const RowFilter &filter)
+{
+    const auto &chem{matcher.chem()};
+    std::ifstream ifs(fileName);
+    if (!ifs.is_open())
+    {
+        throw my_error("Can't open file \"" + fileName + "\"");
+    }
+    StageTimer timer("parse");
+    const auto fileFilter{filter.forFile(fileName)};
+    StageAccumulator readTime("parse.getline");
+    StageAccumulator matchTime("parse.match");
+    StageAccumulator valuesTime("parse.values");
+    std::string line;
+    std::vector<std::string_view> strs;
+    std::vector<double> values;
+    size_t lineNumber{0};
+    size_t matched{0};
+
+    readTime.start();
+    while (getline(ifs, line))
+    {
+        readTime.stop();
+        ++lineNumber;
+        if (splitLineToViews(line, strs) == 0)
+        {
+            readTime.start();
+            continue;
+        }
+        try
+        {
+            matchTime.start();
+            auto it{matcher.match(strs.front())};
+            matchTime.stop();
+
+            if (it != chem.end() && fileFilter.accept(strs))
+            {
+                ++matched;
+                std::cout << strs.front() << std::endl;
+                valuesTime.start();
+                getValuesFromLine(strs, columnElement, lineNumber, values);
+                valuesTime.stop();
+                onMatch(0, it, strs.front(), values);
+            }
+        }
+        catch (const my_error& err)
+        {
+            std::cout << "Error: " << err.what() << std::endl;
+        }
+        readTime.start();
+    }
+    ifs.close();
+    countEvent(Counter::LinesRead, lineNumber);
+    countEvent(Counter::LinesMatched, matched);
+}
+
+std::map<std::string, Data1> getFitResults(const std::string &fileName,
+                   const std::map<int, std::string> &columnElement,
+                   const std::map<std::string, ChemResult> &chem,
+                   const std::regex &pattern,
+                   const RowFilter &filter)
+{
+    std::map<std::string, Data1> data;
+    parseFile(fileName, columnElement, chem, pattern,
+              [&data, &columnElement](size_t, ChemIterator it, std::string_view, const std::vector<double> &values){
+        auto &d{data[(*it).first]};
+        d.chem.a = it->second.a;
+        d.chem.w = it->second.w;
+        d.fr.push_back(getFitResultsFromValues(values, columnElement));
+    }, filter);
+    return data;
+}
+
+std::vector<std::string_view> splitTextToChunks(std::string_view text, const size_t nChunks)
+{
+    std::vector<std::string_view> chunks;
+    size_t begin{0};
+    for (size_t i{1}; i <= nChunks && begin < text.size(); ++i)
+    {
+        auto end{i == nChunks ? text.size() : std::max(begin, text.size() * i / nChunks)};
+        if (end < text.size())
+        {
+            auto pos{text.find('\n', end)};
+            end = pos == std::string_view::npos ? text.size() : pos + 1;
+        }
+        if (end > begin)
+        {
+            chunks.push_back(text.substr(begin, end - begin));
+        }
+        begin = end;
+    }
+    return chunks;
+}
+
+namespace {
+
+const size_t minChunkSize{1 << 16};
+
+struct ChunkEntry {
+    size_t pattern;
+    ChemIterator chem;
+    std::string_view name;
+    std::vector<double> values;
+    std::string error;
+};
+
+}
+
+void scanChunks(const std::vector<std::string_view> &chunks,
+                ThreadPool &pool,
+                const LineCallback &onLine)
+{
+    // line numbers in error messages need the number of lines before each chunk
+    std::vector<size_t> firstLine(chunks.size() + 1, 1);
+    pool.parallelFor(chunks.size(), [&chunks, &firstLine](size_t i){
+        firstLine[i + 1] = static_cast<size_t>(std::count(chunks[i].begin(), chunks[i].end(), '\n'));
+    });
+    for (size_t i{1}; i < firstLine.size(); ++i)
+    {
+        firstLine[i] += firstLine[i - 1];
+    }
+
+    pool.parallelFor(chunks.size(), [&](size_t i){
+        std::vector<std::string_view> strs;
+        auto lineNumber{firstLine[i]};
+        auto text{chunks[i]};
+        while (!text.empty())
+        {
+            auto pos{text.find('\n')};
+            auto line{text.substr(0, pos)};
+            text.remove_prefix(pos == std::string_view::npos ? text.size() : pos + 1);
+            if (splitLineToViews(line, strs) > 0)
+            {
+                onLine(i, lineNumber, strs);
+            }
+            ++lineNumber;
+        }
+        countEvent(Counter::LinesRead, lineNumber - firstLine[i]);
+    });
+}
+
+size_t chunkCount(const size_t size, const unsigned int threads)
+{
+    return std::max<size_t>(1, std::min<size_t>(4 * threads, size / minChunkSize));
+}
+
+void parseMapped(const std::string &fileName,
+                 const std::map<int, std::string> &columnElement,
+                 const std::map<std::string, ChemResult> &chem,
+                 const std::vector<std::regex> &patterns,
+                 const unsigned int nThreads,
+                 const MatchCallback &onMatch,
+                 const RowFilter &filter)
+{
+    std::vector<SampleMatcher> matchers;
+    for (const auto &pattern : patterns)
+    {
+        matchers.emplace_back(chem, pattern);
+    }
+    parseMapped(fileName, columnElement, matchers, nThreads, onMatch, filter);
+}
+
+void parseMapped(const std::string &fileName,
+                 const std::map<int, std::string> &columnElement,
+                 const std::vector<SampleMatcher> &matchers,
+                 const unsigned int nThreads,
+                 const MatchCallback &onMatch,
+                 const RowFilter &filter)
+{
+    StageTimer timer("parse.mapped");
+    const auto fileFilter{filter.forFile(fileName)};
+    MappedFile file(fileName);
+    const auto threads{defaultThreads(nThreads)};
+    ThreadPool pool(threads - 1);
+    const auto chunks{splitTextToChunks(file.data(), chunkCount(file.size(), threads))};
+
+    std::vector<std::vector<ChunkEntry>> entries(chunks.size());
+    scanChunks(chunks, pool, [&](size_t i, size_t lineNumber, const std::vector<std::string_view> &strs){
+        for (size_t p{0}; p < matchers.size(); ++p)
+        {
+            auto it{matchers[p].match(strs.front())};
+            if (it == matchers[p].chem().end())
+            {
+                continue;
+            }
+            if (!fileFilter.accept(strs))
+            {
+                // a row matching several patterns is dropped once
+                return;
+            }
+            try
+            {
+                std::vector<double> values;
+                getValuesFromLine(strs, columnElement, lineNumber, values);
+                entries[i].push_back({ p, it, strs.front(), std::move(values), {} });
+            }
+            catch (const my_error& err)
+            {
+                entries[i].push_back({ p, it, strs.front(), {}, err.what() });
+            }
+        }
+    });
+
+    for (const auto &chunkEntries : entries)
+    {
+        for (const auto &entry : chunkEntries)
+        {
+            if (!entry.error.empty())
+            {
+                std::cout << "Error: " << entry.error << std::endl;
+                continue;
+            }
+            countEvent(Counter::LinesMatched);
+            std::cout << entry.name << std::endl;
+            onMatch(entry.pattern, entry.chem, entry.name, entry.values);
+        }
+    }
+}
+
+std::vector<std::map<std::string, Data1>> getFitResultsMapped(const std::string &fileName,
+                                                              const std::map<int, std::string> &columnElement,
+                                                              const std::map<std::string, ChemResult> &chem,
+                                                              const std::vector<std::regex> &patterns,
+                                                              const unsigned int nThreads,
+                                                              const RowFilter &filter)
+{
+    std::vector<std::map<std::string, Data1>> data(patterns.size());
+    parseMapped(fileName, columnElement, chem, patterns, nThreads,
+                [&data, &columnElement](size_t p, ChemIterator it, std::string_view, const std::vector<double> &values){
+        auto &d{data[p][(*it).first]};
+        d.chem.a = it->second.a;
+        d.chem.w = it->second.w;
+        d.fr.push_back(getFitResultsFromValues(values, columnElement));
+    }, filter);
+    return data;
+}
@@ -0,0 +1,125 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include "common.h"
+#include "rowfilter.h"
+#include "samplekey.h"
+#include "threadpool.h"
+
+#include <functional>
+#include <map>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+std::vector<std::string> splitLineToStrs(const std::string &line);
+
+// Column to element map of all elements from the header "fileName El1 err El2 err ...".
+std::map<int, std::string> getColumnElement(const std::string &fileName);
+
+// The same map from the fields of a header line already read, source names the input in errors.
+std::map<int, std::string> getColumnElement(const std::vector<std::string_view> &header, const std::string &source);
+
+double strToDouble(std::string str);
+
+// Splits line on whitespace into views pointing into line.
+// views is cleared first and keeps its capacity, so a buffer reused across lines does not allocate.
+size_t splitLineToViews(std::string_view line, std::vector<std::string_view> &views);
+
+// Splits a sample name such as "coal_grad_3834_1.substracted.forEachGamma" on '_' and '.' into views pointing into name,
+// empty components are dropped.
+size_t splitSampleName(std::string_view name, std::vector<std::string_view> &parts);
+
+// Parses strs[column] with std::from_chars, throws my_error with line and column on failure.
+double columnToDouble(const std::vector<std::string_view> &strs,
+                      const size_t column,
+                      const size_t lineNumber);
+
+// Called for every matching line with the index of the matched pattern, the matched reference,
+// the sample name and the selected columns as value, error, value, error, ...
+using MatchCallback = std::function<void(size_t pattern,
+                                         ChemIterator chem,
+                                         std::string_view name,
+                                         const std::vector<double> &values)>;
+
+ChemIterator findChem(std::string_view name,
+                      const std::map<std::string, ChemResult> &chem,
+                      const std::regex &pattern);
+
+void getValuesFromLine(const std::vector<std::string_view> &strs,
+                       const std::map<int, std::string> &columnElement,
+                       const size_t lineNumber,
+                       std::vector<double> &values);
+
+std::vector<FitResult> getFitResultsFromValues(const std::vector<double> &values,
+                                               const std::map<int, std::string> &columnElement);
+
+// Reads fileName line by line and calls onMatch for every line matching chem and pattern
+// that is accepted by filter.
+void parseFile(const std::string &fileName,
+               const std::map<int, std::string> &columnElement,
+               const std::map<std::string, ChemResult> &chem,
+               const std::regex &pattern,
+               const MatchCallback &onMatch,
+               const RowFilter &filter = {});
+
+// parseFile for the rows selected by matcher.
+void parseFile(const std::string &fileName,
+               const std::map<int, std::string> &columnElement,
+               const SampleMatcher &matcher,
+               const MatchCallback &onMatch,
+               const RowFilter &filter = {});
+
+std::map<std::string, Data1> getFitResults(const std::string &fileName,
+                                           const std::map<int, std::string> &columnElement,
+                                           const std::map<std::string, ChemResult> &chem,
+                                           const std::regex &pattern,
+                                           const RowFilter &filter = {});
+
+// Splits text into at most nChunks pieces, every piece but the last ends right after a newline.
+std::vector<std::string_view> splitTextToChunks(std::string_view text, const size_t nChunks);
+
+// Called for every non-empty line with the index of its chunk, its number in the file and its fields.
+using LineCallback = std::function<void(size_t chunk,
+                                        size_t lineNumber,
+                                        const std::vector<std::string_view> &strs)>;
+
+// Runs onLine over all lines of chunks (as split by splitTextToChunks) on pool:
+// chunks are scanned concurrently, the lines of one chunk in order by one thread.
+void scanChunks(const std::vector<std::string_view> &chunks,
+                ThreadPool &pool,
+                const LineCallback &onLine);
+
+// Number of chunks worth splitting size bytes into for threads workers.
+size_t chunkCount(const size_t size, const unsigned int threads);
+
+// Memory-mapped variant of parseFile: the file is parsed by nThreads workers (0 - hardware concurrency),
+// onMatch is called from the calling thread in file order.
+void parseMapped(const std::string &fileName,
+                 const std::map<int, std::string> &columnElement,
+                 const std::map<std::string, ChemResult> &chem,
+                 const std::vector<std::regex> &patterns,
+                 const unsigned int nThreads,
+                 const MatchCallback &onMatch,
+                 const RowFilter &filter = {});
+
+// parseMapped with one matcher per pattern.
+void parseMapped(const std::string &fileName,
+                 const std::map<int, std::string> &columnElement,
+                 const std::vector<SampleMatcher> &matchers,
+                 const unsigned int nThreads,
+                 const MatchCallback &onMatch,
+                 const RowFilter &filter = {});
+
+// Memory-mapped variant of getFitResults: the file is parsed once by nThreads workers
+// (0 - hardware concurrency) and one result per pattern is returned, in the order of patterns.
+// Rows are merged in file order, so every result equals the one of getFitResults.
+std::vector<std::map<std::string, Data1>> getFitResultsMapped(const std::string &fileName,
+                                                              const std::map<int, std::string> &columnElement,
+                                                              const std::map<std::string, ChemResult> &chem,
+                                                              const std::vector<std::regex> &patterns,
+                                                              const unsigned int nThreads = 0,
+                                                              const RowFilter &filter = {});
+
+#endif // PARSER_H
@@ -0,0 +1,144 @@
+#include "predict.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define PREDICT_HAVE_AVX2
+#endif
+
+namespace {
+
+void predictScalar(const std::vector<double> &par,
+                   const std::vector<const double *> &columns,
+                   const size_t first,
+                   const size_t n,
+                   double *y)
+{
+    const auto nColumns{columns.size()};
+    for (size_t r{first}; r < n; ++r)
+    {
+        auto res{par[nColumns]};
+        for (size_t e{0}; e < nColumns; ++e)
+        {
+            res += par[e] * columns[e][r];
+        }
+        y[r] = res;
+    }
+}
+
+#ifdef PREDICT_HAVE_AVX2
+// Eight rows per iteration in two accumulators, every column is streamed once, y is written once.
+// Returns the number of rows done, the tail is left to predictScalar.
+__attribute__((target("avx2,fma")))
+size_t predictAvx2(const std::vector<double> &par,
+                   const std::vector<const double *> &columns,
+                   const size_t n,
+                   double *y)
+{
+    const auto nColumns{columns.size()};
+    const auto intercept{_mm256_set1_pd(par[nColumns])};
+    size_t r{0};
+    for (; r + 8 <= n; r += 8)
+    {
+        auto acc0{intercept};
+        auto acc1{intercept};
+        for (size_t e{0}; e < nColumns; ++e)
+        {
+            const auto p{_mm256_broadcast_sd(&par[e])};
+            acc0 = _mm256_fmadd_pd(p, _mm256_loadu_pd(columns[e] + r), acc0);
+            acc1 = _mm256_fmadd_pd(p, _mm256_loadu_pd(columns[e] + r + 4), acc1);
+        }
+        _mm256_storeu_pd(y + r, acc0);
+        _mm256_storeu_pd(y + r + 4, acc1);
+    }
+    return r;
+}
+
+bool haveAvx2()
+{
+    static const bool avx2{__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")};
+    return avx2;
+}
+#endif
+
+}
+
+void predictBatch(const std::vector<double> &par,
+                  const std::vector<const double *> &columns,
+                  const size_t n,
+                  double *y)
+{
+    if (par.size() != columns.size() + 1)
+    {
+        throw my_error("predictBatch: " + std::to_string(par.size()) + " parameters for "
+                       + std::to_string(columns.size()) + " columns");
+    }
+    size_t done{0};
+#ifdef PREDICT_HAVE_AVX2
+    if (haveAvx2())
+    {
+        done = predictAvx2(par, columns, n, y);
+    }
+#endif
+    predictScalar(par, columns, done, n, y);
+}
+
+std::vector<double> predict(const Dataset &data, const std::vector<double> &par)
+{
+    std::vector<const double *> columns;
+    for (const auto &column : data.values)
+    {
+        columns.push_back(column.data());
+    }
+    std::vector<double> y(data.rows());
+    predictBatch(par, columns, y.size(), y.data());
+    return y;
+}
+
+std::vector<std::vector<double>> predict(const Dataset &data, const std::vector<std::vector<double>> &pars)
+{
+    const size_t blockRows{4096};
+    std::vector<std::vector<double>> y(pars.size(), std::vector<double>(data.rows()));
+    std::vector<const double *> columns(data.values.size());
+    for (size_t first{0}; first < data.rows(); first += blockRows)
+    {
+        const auto n{std::min(blockRows, data.rows() - first)};
+        for (size_t e{0}; e < columns.size(); ++e)
+        {
+            columns[e] = data.values[e].data() + first;
+        }
+        for (size_t t{0}; t < pars.size(); ++t)
+        {
+            predictBatch(pars[t], columns, n, y[t].data() + first);
+        }
+    }
+    return y;
+}
+
+PredictionStats predictionStats(const Dataset &data,
+                                const std::vector<double> &predicted,
+                                const Data1::Value value)
+{
+    PredictionStats stats;
+    auto sum{0.0};
+    auto sum2{0.0};
+    for (size_t row{0}; row < data.rows(); ++row)
+    {
+        auto v{data.reference(row, value)};
+        if (v.has_value())
+        {
+            const auto d{predicted[row] - v.value()};
+            sum += predicted[row];
+            sum2 += d * d;
+            ++stats.n;
+        }
+    }
+    if (stats.n > 0)
+    {
+        stats.mean = sum / static_cast<double>(stats.n);
+        stats.rmse = std::sqrt(sum2 / static_cast<double>(stats.n));
+    }
+    return stats;
+}
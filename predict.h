@@ -0,0 +1,34 @@
+#ifndef PREDICT_H
+#define PREDICT_H
+
+#include "dataset.h"
+
+#include <cstddef>
+#include <vector>
+
+// y[r] = par.back() + sum_e par[e] * columns[e][r] for r < n, par has one entry per column plus the intercept.
+// Runs an AVX2 kernel when the CPU has it and a scalar loop otherwise.
+void predictBatch(const std::vector<double> &par,
+                  const std::vector<const double *> &columns,
+                  const size_t n,
+                  double *y);
+
+// Predictions of the calibration par for every row of data.
+std::vector<double> predict(const Dataset &data, const std::vector<double> &par);
+
+// Predictions of several calibrations in one pass: the columns are read block by block
+// and every calibration is applied to a block while it is in cache.
+std::vector<std::vector<double>> predict(const Dataset &data, const std::vector<std::vector<double>> &pars);
+
+struct PredictionStats {
+    size_t n{0};
+    double mean{0.0}; // mean prediction
+    double rmse{0.0}; // root mean square of prediction - reference
+};
+
+// Statistics of predicted against reference over the rows with a reference value for value.
+PredictionStats predictionStats(const Dataset &data,
+                                const std::vector<double> &predicted,
+                                const Data1::Value value);
+
+#endif // PREDICT_H
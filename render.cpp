@@ -0,0 +1,223 @@
+#include "render.h"
+#include "instrument.h"
+
+#include <TCanvas.h>
+#include <TGraph.h>
+#include <TGraphErrors.h>
+#include <TH2.h>
+#include <TLine.h>
+#include <TROOT.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <sstream>
+
+namespace {
+
+struct Points {
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> xErr;
+    std::vector<double> yErr;
+};
+
+// Marker color of a report group: the blind groups keep their colors, other patterns take the next free ones.
+// Rows of the group "other" get otherColor, kWhite leaves them undrawn.
+Color_t groupColor(const std::string &group, const size_t index, const Color_t otherColor)
+{
+    const std::map<std::string, Color_t> colors{
+        { "coal_blind", kRed },
+        { "barz_blind", kBlue },
+        { "bereza_blind", kGreen },
+    };
+    if (group == "other")
+    {
+        return otherColor;
+    }
+    auto it{colors.find(group)};
+    if (it != colors.end())
+    {
+        return it->second;
+    }
+    const Color_t palette[]{ kOrange, kCyan, kViolet, kPink, kSpring, kAzure, kTeal, kYellow };
+    return palette[index % (sizeof(palette) / sizeof(palette[0]))];
+}
+
+// One graph per group of the report, rows carry the index of their group.
+// The graphs must live until the canvas is printed.
+std::vector<std::unique_ptr<TGraph>> drawGroups(const std::vector<double> &x,
+                const std::vector<double> &y,
+                const std::vector<std::uint32_t> &rowGroups,
+                const std::vector<GroupStats> &groups,
+                const Color_t otherColor)
+{
+    std::vector<Points> points(groups.size());
+    for (size_t i{0}; i < x.size(); ++i)
+    {
+        points[rowGroups[i]].x.push_back(x[i]);
+        points[rowGroups[i]].y.push_back(y[i]);
+    }
+    std::vector<std::unique_ptr<TGraph>> graphs;
+    for (size_t g{0}; g < groups.size(); ++g)
+    {
+        const auto color{groupColor(groups[g].group, g, otherColor)};
+        if (color == kWhite || points[g].x.empty())
+        {
+            continue;
+        }
+        graphs.emplace_back(new TGraph(static_cast<int>(points[g].x.size()), points[g].x.data(), points[g].y.data()));
+        graphs.back()->SetMarkerStyle(21);
+        graphs.back()->SetMarkerSize(1.5);
+        graphs.back()->SetMarkerColor(color);
+        graphs.back()->Draw("P SAME");
+    }
+    return graphs;
+}
+
+std::string valueTitle(const Data1::Value value)
+{
+    return value == Data1::Value::A ? "Ad" : "Wr";
+}
+
+}
+
+void renderCalibration(const Report &report, const std::string &psName)
+{
+    StageTimer timer("render");
+    Points points;
+    std::vector<double> predicted;
+    std::vector<std::uint32_t> rowGroups;
+    for (const auto &r : report.rows)
+    {
+        if (r.reference.has_value())
+        {
+            points.x.push_back(static_cast<double>(points.x.size()));
+            points.y.push_back(r.reference.value());
+            points.xErr.push_back(0.01);
+            points.yErr.push_back(0.5);
+            predicted.push_back(r.predicted);
+            rowGroups.push_back(r.group);
+        }
+    }
+    if (points.x.empty())
+    {
+        return;
+    }
+    std::unique_ptr<TGraphErrors> gr{new TGraphErrors(static_cast<int>(points.x.size()), points.x.data(), points.y.data(), points.xErr.data(), points.yErr.data())};
+    gr.get()->SetMarkerSize(1.5);
+    gr.get()->SetMarkerStyle(21);
+    std::string grTitle{";N_probe;"};
+    grTitle.append(report.value == Data1::Value::A ? "A" : "W");
+    gr.get()->SetTitle(grTitle.c_str());
+    std::unique_ptr<TGraph> fitted{new TGraph(static_cast<int>(points.x.size()), points.x.data(), predicted.data())};
+    fitted.get()->SetLineColor(kRed);
+    fitted.get()->SetLineWidth(2);
+
+    std::unique_ptr<TCanvas> c{new TCanvas("c", "c", 1024, 960)};
+    c.get()->Print((psName + '[').c_str());
+    gr.get()->Draw("APL");
+    fitted.get()->Draw("L SAME");
+    auto groups{drawGroups(points.x, points.y, rowGroups, report.groups, kWhite)};
+    c.get()->Print(psName.c_str());
+    c.get()->Print((psName + ']').c_str());
+    c.get()->Close();
+    countWritten(psName);
+}
+
+void renderConvergence(const Report &report, const std::string &psName)
+{
+    StageTimer timer("render");
+    Points points;
+    std::vector<std::uint32_t> rowGroups;
+    for (const auto &r : report.rows)
+    {
+        if (r.reference.has_value())
+        {
+            points.x.push_back(r.predicted);
+            points.y.push_back(r.reference.value());
+            points.xErr.push_back(0.1);
+            points.yErr.push_back(0.5);
+            rowGroups.push_back(r.group);
+        }
+    }
+    if (points.x.empty())
+    {
+        return;
+    }
+    std::unique_ptr<TGraphErrors> gr{new TGraphErrors(static_cast<int>(points.x.size()), points.x.data(), points.y.data(), points.xErr.data(), points.yErr.data())};
+    gr.get()->SetMarkerSize(1.5);
+    gr.get()->SetMarkerStyle(21);
+
+    // group stdAbs in the order and colors of the former per-point drawing
+    const std::map<std::string, Color_t> colors{
+        { "barz_blind", kBlue },
+        { "bereza_blind", kGreen },
+        { "coal_blind", kRed },
+        { "other", kMagenta },
+    };
+    std::stringstream ss;
+    ss << valueTitle(report.value) << ": stdAbs=" << std::setprecision(3);
+    for (const auto &item : colors)
+    {
+        auto it{std::find_if(report.groups.begin(), report.groups.end(), [&item](const GroupStats &g){ return g.group == item.first; })};
+        ss << "[#color[" << static_cast<int>(item.second) << "]{" << (it != report.groups.end() ? it->rmse : 0.0) << "}] ";
+    }
+    ss << ";AGP-K, %;Chem, %";
+
+    const auto yMin{0.75 * (*std::min_element(points.y.begin(), points.y.end()))};
+    const auto yMax{1.25 * (*std::max_element(points.y.begin(), points.y.end()))};
+    std::unique_ptr<TH2D> h2dConv{new TH2D("h2dConv", ss.str().c_str(),
+                                           static_cast<int>(points.y.size()), yMin, yMax,
+                                           static_cast<int>(points.y.size()), yMin, yMax)};
+    h2dConv->SetStats(0);
+    std::unique_ptr<TLine> lConv{new TLine(yMin, yMin, yMax, yMax)};
+
+    std::unique_ptr<TCanvas> c{new TCanvas("c", "c", 1024, 960)};
+    c.get()->Print((psName + '[').c_str());
+    h2dConv.get()->Draw();
+    gr.get()->Draw("P");
+    auto groups{drawGroups(points.x, points.y, rowGroups, report.groups, kMagenta)};
+    lConv.get()->Draw("SAME");
+    c.get()->Print(psName.c_str());
+    c.get()->Print((psName + ']').c_str());
+    c.get()->Close();
+    countWritten(psName);
+}
+
+Renderer::Renderer(const bool async) : _pool{async ? 1u : 0u}
+{
+    if (async)
+    {
+        ROOT::EnableThreadSafety();
+    }
+}
+
+void Renderer::calibration(Report report, const std::string &psName)
+{
+    _pool.submit([report = std::move(report), psName](){
+        try
+        {
+            renderCalibration(report, psName);
+        }
+        catch (const std::exception &err)
+        {
+            std::cout << "Error: " << psName << ": " << err.what() << std::endl;
+        }
+    });
+}
+
+void Renderer::convergence(Report report, const std::string &psName)
+{
+    _pool.submit([report = std::move(report), psName](){
+        try
+        {
+            renderConvergence(report, psName);
+        }
+        catch (const std::exception &err)
+        {
+            std::cout << "Error: " << psName << ": " << err.what() << std::endl;
+        }
+    });
+}
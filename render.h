@@ -0,0 +1,29 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "report.h"
+#include "threadpool.h"
+
+#include <string>
+
+// Calibration plot of report: the reference of every row by its number, the prediction drawn as a line.
+void renderCalibration(const Report &report, const std::string &psName);
+
+// Convergence plot of report: reference against prediction with the per group stdAbs in the title.
+void renderConvergence(const Report &report, const std::string &psName);
+
+// Draws reports in the calling thread or, with async, on one background thread in submission order,
+// the destructor waits for the queued plots. ROOT thread safety is switched on for async drawing,
+// the calling thread must not draw meanwhile.
+class Renderer
+{
+public:
+    explicit Renderer(const bool async);
+
+    void calibration(Report report, const std::string &psName);
+    void convergence(Report report, const std::string &psName);
+private:
+    ThreadPool _pool;
+};
+
+#endif // RENDER_H
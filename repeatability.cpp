@@ -0,0 +1,173 @@
+#include "repeatability.h"
+#include "common.h"
+#include "instrument.h"
+#include "mappedfile.h"
+#include "parser.h"
+#include "samplekey.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cmath>
+
+RunningStats &RunningStats::operator+=(const RunningStats &other)
+{
+    if (other.n == 0)
+    {
+        return *this;
+    }
+    const auto n1{static_cast<double>(n)};
+    const auto n2{static_cast<double>(other.n)};
+    const auto d{other.mean - mean};
+    n += other.n;
+    mean += d * n2 / (n1 + n2);
+    m2 += other.m2 + d * d * n1 * n2 / (n1 + n2);
+    return *this;
+}
+
+double RunningStats::variance() const
+{
+    return n > 1 ? m2 / static_cast<double>(n - 1) : 0.0;
+}
+
+double RunningStats::sd() const
+{
+    return std::sqrt(variance());
+}
+
+std::optional<ReplicateName> parseReplicateName(std::string_view name)
+{
+    const auto key{parseSampleKey(name)};
+    if (key.kind != SampleKind::Povtor)
+    {
+        return std::nullopt;
+    }
+    // the series is the name up to "_povtor"
+    const auto seriesEnd{static_cast<size_t>(key.id.data() + key.id.size() - name.data())};
+    return ReplicateName{ std::string(name.substr(0, seriesEnd)), key.replicate.value() };
+}
+
+void Repeatability::print() const
+{
+    std::cout << "repeatability: series n mean sd r" << std::endl;
+    for (const auto &s : series)
+    {
+        std::cout << s.series << " " << s.stats.n << " " << s.stats.mean << " " << s.stats.sd() << " " << s.limit << std::endl;
+    }
+    std::cout << "pooled: n = " << n << " sd = " << pooledSd << " r = " << limit << std::endl;
+    std::cout << "all: avg = " << all.mean << " stdAbs = " << all.sd() << std::endl;
+}
+
+void RepeatabilityAccumulator::add(const ReplicateName &replicate, const double prediction)
+{
+    _series[replicate.series].add(prediction);
+}
+
+RepeatabilityAccumulator &RepeatabilityAccumulator::operator+=(const RepeatabilityAccumulator &other)
+{
+    for (const auto &item : other._series)
+    {
+        _series[item.first] += item.second;
+    }
+    return *this;
+}
+
+Repeatability RepeatabilityAccumulator::result() const
+{
+    Repeatability r;
+    auto m2{0.0};
+    size_t dof{0};
+    for (const auto &item : _series)
+    {
+        r.series.push_back({ item.first, item.second, repeatabilityFactor * item.second.sd() });
+        r.all += item.second;
+        r.n += item.second.n;
+        m2 += item.second.m2;
+        dof += item.second.n - 1;
+    }
+    if (dof > 0)
+    {
+        r.pooledSd = std::sqrt(m2 / static_cast<double>(dof));
+        r.limit = repeatabilityFactor * r.pooledSd;
+    }
+    return r;
+}
+
+Repeatability streamRepeatability(const std::vector<std::string> &fileNames,
+                                  const std::vector<std::string> &elements,
+                                  const std::vector<double> &par,
+                                  const unsigned int nThreads,
+                                  const RowFilter &filter)
+{
+    if (par.size() != elements.size() + 1)
+    {
+        throw my_error("streamRepeatability: " + std::to_string(par.size()) + " parameters for "
+                       + std::to_string(elements.size()) + " elements");
+    }
+    StageTimer timer("repeatability");
+    const auto threads{defaultThreads(nThreads)};
+    ThreadPool pool(threads - 1);
+    RepeatabilityAccumulator total;
+    for (const auto &fileName : fileNames)
+    {
+        // the elements of the calibration in the column order of this file, with their parameters
+        const auto fileColumns{getColumnElement(fileName)};
+        std::map<int, std::string> columnElement;
+        std::vector<double> filePar;
+        for (const auto &item : fileColumns)
+        {
+            const auto it{std::find(elements.begin(), elements.end(), item.second)};
+            if (it != elements.end())
+            {
+                columnElement.insert(item);
+                filePar.push_back(par[static_cast<size_t>(it - elements.begin())]);
+            }
+        }
+        if (columnElement.size() != elements.size())
+        {
+            throw my_error("Header of \"" + fileName + "\" lacks elements of the calibration");
+        }
+        const auto fileFilter{filter.forColumns(fileColumns, fileName)};
+
+        MappedFile file(fileName);
+        const auto chunks{splitTextToChunks(file.data(), chunkCount(file.size(), threads))};
+        std::vector<RepeatabilityAccumulator> partial(chunks.size());
+        std::vector<std::vector<std::string>> errors(chunks.size());
+        scanChunks(chunks, pool, [&](size_t i, size_t lineNumber, const std::vector<std::string_view> &strs){
+            const auto replicate{parseReplicateName(strs.front())};
+            if (!replicate.has_value())
+            {
+                return;
+            }
+            if (!fileFilter.accept(strs))
+            {
+                return;
+            }
+            thread_local std::vector<double> values;
+            try
+            {
+                getValuesFromLine(strs, columnElement, lineNumber, values);
+            }
+            catch (const my_error &err)
+            {
+                errors[i].push_back(err.what());
+                return;
+            }
+            auto prediction{par.back()};
+            for (size_t e{0}; e < filePar.size(); ++e)
+            {
+                prediction += filePar[e] * values[2 * e];
+            }
+            partial[i].add(replicate.value(), prediction);
+            countEvent(Counter::LinesMatched);
+        });
+        for (size_t i{0}; i < chunks.size(); ++i)
+        {
+            for (const auto &error : errors[i])
+            {
+                std::cout << "Error: " << error << std::endl;
+            }
+            total += partial[i];
+        }
+    }
+    return total.result();
+}
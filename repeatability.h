@@ -0,0 +1,81 @@
+#ifndef REPEATABILITY_H
+#define REPEATABILITY_H
+
+#include "rowfilter.h"
+
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Running mean and variance by Welford's update, two of them merge exactly (Chan et al.),
+// so a series can be split over threads or files and any number of values takes constant memory.
+struct RunningStats {
+    size_t n{0};
+    double mean{0.0};
+    double m2{0.0}; // sum of squared deviations from the mean
+
+    void add(const double x)
+    {
+        ++n;
+        const auto d{x - mean};
+        mean += d / static_cast<double>(n);
+        m2 += d * (x - mean);
+    }
+    RunningStats &operator+=(const RunningStats &other);
+    // sample variance, 0 below two values
+    double variance() const;
+    double sd() const;
+};
+
+// Replicate measurement of a sample as named by the "_povtor_N" convention:
+// "coal_grad_3834_povtor_7.substracted.forEachGamma" is replicate 7 of series "coal_grad_3834".
+struct ReplicateName {
+    std::string series;
+    size_t replicate{0};
+};
+
+std::optional<ReplicateName> parseReplicateName(std::string_view name);
+
+// Limit of the absolute difference of two replicates at 95% (ISO 5725-6), r = 2.8 * sd.
+const double repeatabilityFactor{2.8};
+
+struct SeriesRepeatability {
+    std::string series;
+    RunningStats stats;
+    double limit{0.0};
+};
+
+struct Repeatability {
+    std::vector<SeriesRepeatability> series; // in the order of the series names
+    size_t n{0};
+    double pooledSd{0.0}; // within-series sd, sqrt(sum m2 / sum (n - 1))
+    double limit{0.0};    // repeatabilityFactor * pooledSd
+    RunningStats all;     // all predictions pooled together, as calcRep used to report
+    void print() const;
+};
+
+// Predictions grouped by replicate series, fed one at a time.
+class RepeatabilityAccumulator
+{
+public:
+    void add(const ReplicateName &replicate, const double prediction);
+    RepeatabilityAccumulator &operator+=(const RepeatabilityAccumulator &other);
+    Repeatability result() const;
+private:
+    std::map<std::string, RunningStats> _series;
+};
+
+// One pass over fileNames predicting every replicate row with the calibration par of elements
+// (intercept last). The columns of every file are found by name in its header. Chunks of a file
+// are scanned in parallel with their own accumulators, nothing but the per-series sums is kept.
+// Rows filter does not accept are skipped.
+Repeatability streamRepeatability(const std::vector<std::string> &fileNames,
+                                  const std::vector<std::string> &elements,
+                                  const std::vector<double> &par,
+                                  const unsigned int nThreads = 0,
+                                  const RowFilter &filter = {});
+
+#endif // REPEATABILITY_H
@@ -0,0 +1,343 @@
+#include "report.h"
+#include "groupstats.h"
+#include "instrument.h"
+#include "parser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <sstream>
+
+namespace {
+
+std::string valueName(const Data1::Value value)
+{
+    return value == Data1::Value::A ? "A" : "W";
+}
+
+std::ofstream openOutput(const std::string &fileName)
+{
+    std::ofstream ofs(fileName);
+    if (!ofs.is_open())
+    {
+        throw my_error("Can't open file \"" + fileName + "\"");
+    }
+    ofs << std::setprecision(std::numeric_limits<double>::max_digits10);
+    return ofs;
+}
+
+std::string jsonString(const std::string &str)
+{
+    std::string r{"\""};
+    for (auto c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            r += '\\';
+        }
+        r += c;
+    }
+    return r + "\"";
+}
+
+std::string jsonNumber(const double v)
+{
+    if (!std::isfinite(v))
+    {
+        return "null";
+    }
+    std::ostringstream ss;
+    ss << std::setprecision(std::numeric_limits<double>::max_digits10) << v;
+    return ss.str();
+}
+
+// CSV lines of a report file: the leading columns of the header checked, then one vector of fields per line.
+// Columns added to a file later are ignored by the readers of the older columns.
+std::vector<std::vector<std::string>> readCsv(const std::string &fileName, const std::string &header)
+{
+    std::ifstream ifs(fileName);
+    if (!ifs.is_open())
+    {
+        throw my_error("Can't open file \"" + fileName + "\"");
+    }
+    std::string line;
+    if (!getline(ifs, line) || line.compare(0, header.size(), header) != 0)
+    {
+        throw my_error("\"" + fileName + "\" does not start with \"" + header + "\"");
+    }
+    std::vector<std::vector<std::string>> lines;
+    while (getline(ifs, line))
+    {
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (getline(ss, field, ','))
+        {
+            fields.push_back(field);
+        }
+        lines.push_back(fields);
+    }
+    return lines;
+}
+
+double fieldToDouble(const std::vector<std::string> &fields, const size_t column, const size_t lineNumber)
+{
+    if (column >= fields.size() || fields[column].empty())
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    std::vector<std::string_view> views(fields.begin(), fields.end());
+    return columnToDouble(views, column, lineNumber);
+}
+
+}
+
+const std::vector<std::string> &blindGroups()
+{
+    static const std::vector<std::string> groups{ "coal_blind", "barz_blind", "bereza_blind" };
+    return groups;
+}
+
+Report makeReport(const std::string &name,
+                  const Dataset &data,
+                  const std::vector<size_t> &rows,
+                  const std::vector<double> &predicted,
+                  const Data1::Value value,
+                  const std::vector<double> &par,
+                  const std::vector<double> &parErr,
+                  const std::vector<std::string> &groupPatterns)
+{
+    Report report;
+    report.name = name;
+    report.value = value;
+    report.parNames = data.elements;
+    report.parNames.push_back("const");
+    report.par = par;
+    report.parErr = parErr.empty() ? std::vector<double>(par.size(), 0.0) : parErr;
+
+    const auto grouping{groupSamples(data.samples, groupPatterns)};
+    GroupAccumulator accumulator(grouping.names, { value });
+    report.rows.reserve(rows.size());
+    for (auto row : rows)
+    {
+        const auto sample{data.rowSample[row]};
+        ReportRow r{ data.samples[sample], data.indexInSample(row), predicted[row], data.reference(row, value), grouping.sampleGroup[sample] };
+        if (r.reference.has_value())
+        {
+            accumulator.add(r.group, 0, r.predicted, r.reference.value());
+        }
+        report.rows.push_back(std::move(r));
+    }
+    const auto total{accumulator.total(0)};
+    report.avg = total.mean;
+    report.stdAbs = total.n > 0 ? total.rmse : 0.0;
+    for (size_t g{0}; g < grouping.names.size(); ++g)
+    {
+        const auto s{accumulator.summary(g, 0)};
+        report.groups.push_back({ s.group, s.n, s.rmse, s.mean, s.bias });
+    }
+    return report;
+}
+
+Report calcConv(const Dataset &data,
+                const std::vector<double> &predicted,
+                const Data1::Value value,
+                const std::vector<double> &par,
+                const std::vector<std::string> &groupPatterns)
+{
+    std::vector<size_t> rows(data.rows());
+    std::iota(rows.begin(), rows.end(), 0);
+    auto report{makeReport("convergence", data, rows, predicted, value, par, {}, groupPatterns)};
+    std::cout << "convergence: " << "avg = " << report.avg << " stdAbs = " << report.stdAbs << std::endl;
+    return report;
+}
+
+void writeReport(const Report &report, const std::string &dir)
+{
+    StageTimer timer("report.write");
+    const auto prefix{dir + "/" + report.name};
+    {
+        auto ofs{openOutput(prefix + "_fit.csv")};
+        ofs << "parameter,value,error" << std::endl;
+        for (size_t i{0}; i < report.par.size(); ++i)
+        {
+            ofs << report.parNames[i] << "," << report.par[i] << "," << report.parErr[i] << std::endl;
+        }
+        ofs << "chi2," << report.chi2 << "," << std::endl;
+        ofs << "ndf," << report.ndf << "," << std::endl;
+        ofs << "value," << valueName(report.value) << "," << std::endl;
+        countWritten(ofs);
+    }
+    {
+        auto ofs{openOutput(prefix + "_rows.csv")};
+        ofs << "sample,index,predicted,reference" << std::endl;
+        for (const auto &r : report.rows)
+        {
+            ofs << r.sample << "," << r.index << "," << r.predicted << ",";
+            if (r.reference.has_value())
+            {
+                ofs << r.reference.value();
+            }
+            ofs << std::endl;
+        }
+        countWritten(ofs);
+    }
+    {
+        auto ofs{openOutput(prefix + "_groups.csv")};
+        ofs << "group,n,rmse,mean,bias" << std::endl;
+        const auto n{std::count_if(report.rows.begin(), report.rows.end(), [](const ReportRow &r){ return r.reference.has_value(); })};
+        auto bias{0.0};
+        for (const auto &g : report.groups)
+        {
+            bias += static_cast<double>(g.n) * g.bias;
+        }
+        ofs << "all," << n << "," << report.stdAbs << "," << report.avg << "," << (n > 0 ? bias / static_cast<double>(n) : 0.0) << std::endl;
+        for (const auto &g : report.groups)
+        {
+            ofs << g.group << "," << g.n << ",";
+            if (g.n > 0)
+            {
+                ofs << g.rmse << "," << g.mean << "," << g.bias;
+            }
+            else
+            {
+                ofs << ",,";
+            }
+            ofs << std::endl;
+        }
+        countWritten(ofs);
+    }
+    auto ofs{openOutput(prefix + ".json")};
+    ofs << "{" << std::endl;
+    ofs << "  \"name\": " << jsonString(report.name) << "," << std::endl;
+    ofs << "  \"value\": " << jsonString(valueName(report.value)) << "," << std::endl;
+    ofs << "  \"chi2\": " << jsonNumber(report.chi2) << ", \"ndf\": " << report.ndf << "," << std::endl;
+    ofs << "  \"avg\": " << jsonNumber(report.avg) << ", \"stdAbs\": " << jsonNumber(report.stdAbs) << "," << std::endl;
+    ofs << "  \"parameters\": [";
+    for (size_t i{0}; i < report.par.size(); ++i)
+    {
+        ofs << (i > 0 ? ", " : "") << "{\"name\": " << jsonString(report.parNames[i]) << ", \"value\": " << jsonNumber(report.par[i])
+            << ", \"error\": " << jsonNumber(report.parErr[i]) << "}";
+    }
+    ofs << "]," << std::endl;
+    ofs << "  \"groups\": [";
+    for (size_t i{0}; i < report.groups.size(); ++i)
+    {
+        const auto &g{report.groups[i]};
+        ofs << (i > 0 ? ", " : "") << "{\"group\": " << jsonString(g.group) << ", \"n\": " << g.n << ", \"rmse\": " << jsonNumber(g.rmse)
+            << ", \"mean\": " << jsonNumber(g.mean) << ", \"bias\": " << jsonNumber(g.bias) << "}";
+    }
+    ofs << "]," << std::endl;
+    ofs << "  \"rows\": [" << std::endl;
+    for (size_t i{0}; i < report.rows.size(); ++i)
+    {
+        const auto &r{report.rows[i]};
+        ofs << "    {\"sample\": " << jsonString(r.sample) << ", \"index\": " << r.index << ", \"predicted\": " << jsonNumber(r.predicted)
+            << ", \"reference\": " << (r.reference.has_value() ? jsonNumber(r.reference.value()) : "null") << "}"
+            << (i + 1 < report.rows.size() ? "," : "") << std::endl;
+    }
+    ofs << "  ]" << std::endl;
+    ofs << "}" << std::endl;
+    countWritten(ofs);
+}
+
+Report readReport(const std::string &dir, const std::string &name)
+{
+    const auto prefix{dir + "/" + name};
+    Report report;
+    report.name = name;
+    size_t lineNumber{1};
+    for (const auto &fields : readCsv(prefix + "_fit.csv", "parameter,value,error"))
+    {
+        ++lineNumber;
+        if (fields.empty())
+        {
+            continue;
+        }
+        if (fields[0] == "chi2")
+        {
+            report.chi2 = fieldToDouble(fields, 1, lineNumber);
+        }
+        else if (fields[0] == "ndf")
+        {
+            report.ndf = static_cast<int>(fieldToDouble(fields, 1, lineNumber));
+        }
+        else if (fields[0] == "value")
+        {
+            report.value = fields.size() > 1 && fields[1] == "W" ? Data1::Value::W : Data1::Value::A;
+        }
+        else
+        {
+            report.parNames.push_back(fields[0]);
+            report.par.push_back(fieldToDouble(fields, 1, lineNumber));
+            report.parErr.push_back(fieldToDouble(fields, 2, lineNumber));
+        }
+    }
+    lineNumber = 1;
+    for (const auto &fields : readCsv(prefix + "_rows.csv", "sample,index,predicted,reference"))
+    {
+        ++lineNumber;
+        ReportRow r{ fields.at(0), static_cast<size_t>(fieldToDouble(fields, 1, lineNumber)), fieldToDouble(fields, 2, lineNumber), std::nullopt };
+        if (fields.size() > 3 && !fields[3].empty())
+        {
+            r.reference = fieldToDouble(fields, 3, lineNumber);
+        }
+        report.rows.push_back(std::move(r));
+    }
+    lineNumber = 1;
+    for (const auto &fields : readCsv(prefix + "_groups.csv", "group,n,rmse"))
+    {
+        ++lineNumber;
+        GroupStats g{ fields.at(0), static_cast<size_t>(fieldToDouble(fields, 1, lineNumber)), fieldToDouble(fields, 2, lineNumber),
+                      fieldToDouble(fields, 3, lineNumber), fieldToDouble(fields, 4, lineNumber) };
+        if (g.group == "all")
+        {
+            report.stdAbs = g.rmse;
+            continue;
+        }
+        report.groups.push_back(g);
+    }
+    // the groups of the rows are resolved again from the group names, once per sample
+    std::vector<std::string> patterns;
+    for (const auto &g : report.groups)
+    {
+        if (g.group != "other")
+        {
+            patterns.push_back(g.group);
+        }
+    }
+    if (report.groups.empty() || report.groups.back().group != "other")
+    {
+        report.groups.push_back({ "other", 0, std::numeric_limits<double>::quiet_NaN() });
+    }
+    std::vector<std::string> samples;
+    std::map<std::string, size_t> sampleIndex;
+    for (const auto &r : report.rows)
+    {
+        if (sampleIndex.emplace(r.sample, samples.size()).second)
+        {
+            samples.push_back(r.sample);
+        }
+    }
+    const auto grouping{groupSamples(samples, patterns)};
+    for (auto &r : report.rows)
+    {
+        r.group = grouping.sampleGroup[sampleIndex.at(r.sample)];
+    }
+    auto sum{0.0};
+    size_t n{0};
+    for (const auto &r : report.rows)
+    {
+        if (r.reference.has_value())
+        {
+            sum += r.predicted;
+            ++n;
+        }
+    }
+    report.avg = n > 0 ? sum / static_cast<double>(n) : 0.0;
+    return report;
+}
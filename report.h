@@ -0,0 +1,71 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include "dataset.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct ReportRow {
+    std::string sample;
+    size_t index{0}; // in the sample
+    double predicted{0.0};
+    std::optional<double> reference;
+    std::uint32_t group{0}; // index into Report::groups
+};
+
+struct GroupStats {
+    std::string group;
+    size_t n{0};
+    double rmse{0.0};
+    double mean{0.0}; // mean prediction
+    double bias{0.0}; // mean of prediction - reference
+};
+
+// Numbers behind one plot: the calibration parameters and the predicted and reference value of every row.
+// Reports are written as CSV and JSON, and plots are drawn from them only (see render.h),
+// so they can be drawn later or on another thread.
+struct Report {
+    std::string name;
+    Data1::Value value{Data1::Value::A};
+    std::vector<std::string> parNames;
+    std::vector<double> par;
+    std::vector<double> parErr;
+    double chi2{0.0};
+    int ndf{0};
+    std::vector<ReportRow> rows;
+    double avg{0.0};    // mean prediction of the rows with a reference
+    double stdAbs{0.0}; // root mean square of prediction - reference over those rows
+    std::vector<GroupStats> groups;
+};
+
+// Group patterns of the blind samples, rows whose sample matches none of them form the group "other".
+const std::vector<std::string> &blindGroups();
+
+// Report of the rows of data with predictions predicted (indexed by row of data) of the calibration par,
+// avg, stdAbs and groups are filled from the rows with a reference value in one pass, see groupstats.h.
+Report makeReport(const std::string &name,
+                  const Dataset &data,
+                  const std::vector<size_t> &rows,
+                  const std::vector<double> &predicted,
+                  const Data1::Value value,
+                  const std::vector<double> &par,
+                  const std::vector<double> &parErr = {},
+                  const std::vector<std::string> &groupPatterns = blindGroups());
+
+// Convergence report of predicted (one value per row of data) of the calibration par against the references of value.
+Report calcConv(const Dataset &data,
+                const std::vector<double> &predicted,
+                const Data1::Value value,
+                const std::vector<double> &par,
+                const std::vector<std::string> &groupPatterns = blindGroups());
+
+// Writes dir/<name>_fit.csv, dir/<name>_rows.csv, dir/<name>_groups.csv and dir/<name>.json.
+void writeReport(const Report &report, const std::string &dir);
+
+// Reads a report back from the CSV files of writeReport.
+Report readReport(const std::string &dir, const std::string &name);
+
+#endif // REPORT_H
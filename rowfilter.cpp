@@ -0,0 +1,191 @@
+#include "rowfilter.h"
+#include "common.h"
+#include "instrument.h"
+#include "parser.h"
+
+#include <charconv>
+
+namespace {
+
+bool parseNumber(std::string_view str, double &value)
+{
+    const auto [end, ec]{std::from_chars(str.data(), str.data() + str.size(), value)};
+    return ec == std::errc() && end == str.data() + str.size();
+}
+
+bool parseIndex(std::string_view str, size_t &index)
+{
+    const auto [end, ec]{std::from_chars(str.data(), str.data() + str.size(), index)};
+    return !str.empty() && ec == std::errc() && end == str.data() + str.size();
+}
+
+std::string_view trim(std::string_view str)
+{
+    const auto begin{str.find_first_not_of(" \t")};
+    if (begin == std::string_view::npos)
+    {
+        return {};
+    }
+    return str.substr(begin, str.find_last_not_of(" \t") - begin + 1);
+}
+
+}
+
+RowFilter::RowFilter(const std::vector<std::string> &expressions)
+{
+    for (const auto &expression : expressions)
+    {
+        _conditions.push_back(parse(expression));
+    }
+    _dropped = std::make_shared<std::vector<std::atomic<std::uint64_t>>>(_conditions.size());
+}
+
+RowFilter::Condition RowFilter::parse(const std::string &expression)
+{
+    // two-character operators first, so "<=" is not read as "<"
+    const std::vector<std::pair<std::string_view, Op>> ops{
+        { "<=", Op::LessEqual },
+        { ">=", Op::GreaterEqual },
+        { "==", Op::Equal },
+        { "!=", Op::NotEqual },
+        { "<", Op::Less },
+        { ">", Op::Greater },
+    };
+    const std::string_view text{expression};
+    for (const auto &op : ops)
+    {
+        const auto pos{text.find(op.first)};
+        if (pos == std::string_view::npos)
+        {
+            continue;
+        }
+        Condition c;
+        c.text = expression;
+        c.op = op.second;
+        const auto column{trim(text.substr(0, pos))};
+        if (!parseNumber(trim(text.substr(pos + op.first.size())), c.value) || column.empty())
+        {
+            break;
+        }
+        const auto errPos{column.size() >= 4 ? column.size() - 4 : std::string_view::npos};
+        if (column.front() == '$' && parseIndex(column.substr(1), c.index))
+        {
+            c.field = Field::Raw;
+        }
+        else if (column.front() == 'x' && parseIndex(column.substr(1), c.index))
+        {
+            c.field = Field::Extra;
+        }
+        else if (errPos != std::string_view::npos && errPos > 0 && column.substr(errPos) == ".err")
+        {
+            c.field = Field::Error;
+            c.element = column.substr(0, errPos);
+        }
+        else
+        {
+            c.field = Field::Value;
+            c.element = column;
+        }
+        return c;
+    }
+    throw my_error("Wrong filter \"" + expression + "\", expected <column><op><number>");
+}
+
+RowFilter RowFilter::forFile(const std::string &fileName) const
+{
+    return empty() ? *this : forColumns(getColumnElement(fileName), fileName);
+}
+
+RowFilter RowFilter::forColumns(const std::map<int, std::string> &columnElement, const std::string &source) const
+{
+    auto filter{*this};
+    const auto firstExtra{columnElement.empty() ? size_t{1} : static_cast<size_t>(columnElement.rbegin()->first) + 2};
+    for (auto &c : filter._conditions)
+    {
+        switch (c.field)
+        {
+        case Field::Raw:
+            c.column = c.index;
+            break;
+        case Field::Extra:
+            c.column = firstExtra + c.index;
+            break;
+        case Field::Value:
+        case Field::Error:
+        {
+            auto it{columnElement.begin()};
+            while (it != columnElement.end() && it->second != c.element)
+            {
+                ++it;
+            }
+            if (it == columnElement.end())
+            {
+                throw my_error("Filter \"" + c.text + "\": no element " + c.element + " in \"" + source + "\"");
+            }
+            c.column = static_cast<size_t>(it->first) + (c.field == Field::Error ? 1 : 0);
+            break;
+        }
+        }
+    }
+    return filter;
+}
+
+bool RowFilter::accept(const std::vector<std::string_view> &strs) const
+{
+    for (size_t i{0}; i < _conditions.size(); ++i)
+    {
+        const auto &c{_conditions[i]};
+        double v{0.0};
+        auto pass{c.column < strs.size() && parseNumber(strs[c.column], v)};
+        if (pass)
+        {
+            switch (c.op)
+            {
+            case Op::Less:
+                pass = v < c.value;
+                break;
+            case Op::LessEqual:
+                pass = v <= c.value;
+                break;
+            case Op::Greater:
+                pass = v > c.value;
+                break;
+            case Op::GreaterEqual:
+                pass = v >= c.value;
+                break;
+            case Op::Equal:
+                pass = v == c.value;
+                break;
+            case Op::NotEqual:
+                pass = v != c.value;
+                break;
+            }
+        }
+        if (!pass)
+        {
+            (*_dropped)[i].fetch_add(1, std::memory_order_relaxed);
+            countEvent(Counter::RowsFiltered);
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<std::uint64_t> RowFilter::dropped() const
+{
+    std::vector<std::uint64_t> r;
+    for (size_t i{0}; i < _conditions.size(); ++i)
+    {
+        r.push_back((*_dropped)[i].load());
+    }
+    return r;
+}
+
+void RowFilter::print() const
+{
+    const auto counts{dropped()};
+    for (size_t i{0}; i < _conditions.size(); ++i)
+    {
+        std::cout << "filter " << _conditions[i].text << ": dropped " << counts[i] << std::endl;
+    }
+}
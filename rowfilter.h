@@ -0,0 +1,72 @@
+#ifndef ROWFILTER_H
+#define ROWFILTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Conditions every row must meet to be read, checked on the fields of the line before anything is
+// converted or stored. A condition is "<column><op><number>" with op one of < <= > >= == != and column
+//   Al     - value of element Al
+//   Al.err - its error
+//   xN     - field N (from 0) after the last error, e.g. the fit quality fields
+//   $N     - field N of the line, 0 is the sample name
+// A row lacking the field or holding no number there fails the condition.
+class RowFilter
+{
+public:
+    RowFilter() = default;
+    // Throws my_error on an expression that does not parse.
+    explicit RowFilter(const std::vector<std::string> &expressions);
+
+    bool empty() const
+    {
+        return _conditions.empty();
+    }
+    // The filter with its columns found in the header of fileName, throws my_error on an unknown element.
+    // Copies count the dropped rows together.
+    RowFilter forFile(const std::string &fileName) const;
+    // forFile for the header columnElement of an input read otherwise, source names it in errors.
+    RowFilter forColumns(const std::map<int, std::string> &columnElement, const std::string &source) const;
+    // Checks the conditions in order, a failed one counts the row as dropped by it.
+    // Only the filter returned by forFile knows its columns.
+    bool accept(const std::vector<std::string_view> &strs) const;
+    // Rows dropped by each condition so far.
+    std::vector<std::uint64_t> dropped() const;
+    void print() const;
+private:
+    enum class Op {
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Equal,
+        NotEqual
+    };
+    enum class Field {
+        Value,
+        Error,
+        Extra,
+        Raw
+    };
+    struct Condition {
+        std::string text;
+        std::string element; // of Value and Error
+        Field field{Field::Raw};
+        size_t index{0};     // of Extra and Raw
+        Op op{Op::Less};
+        double value{0.0};
+        size_t column{std::string::npos};
+    };
+
+    static Condition parse(const std::string &expression);
+
+    std::vector<Condition> _conditions;
+    std::shared_ptr<std::vector<std::atomic<std::uint64_t>>> _dropped;
+};
+
+#endif // ROWFILTER_H
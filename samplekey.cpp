@@ -0,0 +1,220 @@
+#include "samplekey.h"
+#include "parser.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace {
+
+// Tokens of the part of name before the first '.', split on '_', empty ones dropped.
+void splitKey(std::string_view name, std::vector<std::string_view> &tokens)
+{
+    tokens.clear();
+    name = name.substr(0, name.find('.'));
+    while (!name.empty())
+    {
+        const auto pos{name.find('_')};
+        if (pos != 0)
+        {
+            tokens.push_back(name.substr(0, pos));
+        }
+        name.remove_prefix(pos == std::string_view::npos ? name.size() : pos + 1);
+    }
+}
+
+std::optional<size_t> toNumber(std::string_view token)
+{
+    size_t n{0};
+    const auto [end, ec]{std::from_chars(token.data(), token.data() + token.size(), n)};
+    if (token.empty() || ec != std::errc() || end != token.data() + token.size())
+    {
+        return std::nullopt;
+    }
+    return n;
+}
+
+// The tokens first to last as one view of the name they point into.
+std::string_view span(const std::vector<std::string_view> &tokens, const size_t first, const size_t last)
+{
+    if (first >= last)
+    {
+        return {};
+    }
+    const auto *begin{tokens[first].data()};
+    const auto *end{tokens[last - 1].data() + tokens[last - 1].size()};
+    return { begin, static_cast<size_t>(end - begin) };
+}
+
+// Replicates of the calibration rows have one digit, as the regex \d+_\d\. took them: coal_grad_3834_12 is not one.
+bool singleDigitReplicate(std::string_view name)
+{
+    name = name.substr(0, name.find('.'));
+    return name.size() >= 2 && name[name.size() - 2] == '_' && name.back() >= '0' && name.back() <= '9';
+}
+
+// Samples are the same if their index keys are: blind samples by material and id, the others by series and id.
+void indexKey(const SampleKey &key, std::string &out)
+{
+    out.clear();
+    if (key.kind == SampleKind::Blind)
+    {
+        out.append("b|").append(key.material).append("|").append(key.id);
+    }
+    else
+    {
+        out.append("g|").append(key.series).append("|").append(key.id);
+    }
+}
+
+}
+
+const char *sampleKindName(const SampleKind kind)
+{
+    switch (kind)
+    {
+    case SampleKind::Grad:
+        return "grad";
+    case SampleKind::Sum:
+        return "sum";
+    case SampleKind::Povtor:
+        return "povtor";
+    case SampleKind::Blind:
+        return "blind";
+    case SampleKind::Other:
+        return "other";
+    }
+    return "other";
+}
+
+SampleKind sampleKindFromString(const std::string &name)
+{
+    for (auto kind : {SampleKind::Grad, SampleKind::Sum, SampleKind::Povtor, SampleKind::Blind, SampleKind::Other})
+    {
+        if (name == sampleKindName(kind))
+        {
+            return kind;
+        }
+    }
+    throw my_error("Unknown sample kind \"" + name + "\"");
+}
+
+SampleKey parseSampleKey(std::string_view name)
+{
+    thread_local std::vector<std::string_view> tokens;
+    splitKey(name, tokens);
+    SampleKey key;
+    if (tokens.size() < 2)
+    {
+        key.id = span(tokens, 0, tokens.size());
+        return key;
+    }
+    key.material = tokens[0];
+    if (tokens[1] == "blind")
+    {
+        key.kind = SampleKind::Blind;
+        key.id = span(tokens, 2, tokens.size());
+        return key;
+    }
+    if (tokens[1] != "grad")
+    {
+        key.id = span(tokens, 1, tokens.size());
+        return key;
+    }
+    // coal_grad_<series>_<id>_<replicate>, _sum or _povtor_<replicate>
+    auto last{tokens.size()};
+    const auto povtor{std::find(tokens.begin() + 2, tokens.end(), std::string_view{"povtor"})};
+    if (povtor != tokens.end() && povtor + 2 == tokens.end() && toNumber(tokens.back()).has_value())
+    {
+        key.kind = SampleKind::Povtor;
+        key.replicate = toNumber(tokens.back());
+        last -= 2;
+    }
+    else if (tokens.back() == "sum")
+    {
+        key.kind = SampleKind::Sum;
+        last -= 1;
+    }
+    else if (tokens.size() > 3 && toNumber(tokens.back()).has_value())
+    {
+        key.kind = SampleKind::Grad;
+        key.replicate = toNumber(tokens.back());
+        last -= 1;
+    }
+    if (last <= 2)
+    {
+        key.kind = SampleKind::Other;
+        key.replicate.reset();
+        return key;
+    }
+    key.id = tokens[last - 1];
+    key.series = span(tokens, 2, last - 1);
+    return key;
+}
+
+SampleIndex::SampleIndex(const std::map<std::string, ChemResult> &chem)
+    : _chem{&chem}
+{
+    std::vector<std::string_view> tokens;
+    std::string k;
+    for (auto it{chem.begin()}; it != chem.end(); ++it)
+    {
+        auto key{parseSampleKey(it->first)};
+        if (key.kind == SampleKind::Other)
+        {
+            // short form of a calibration sample: [series_]id[_]
+            splitKey(it->first, tokens);
+            if (tokens.empty())
+            {
+                throw my_error("Reference key \"" + it->first + "\" names no sample");
+            }
+            key.kind = SampleKind::Grad;
+            key.id = tokens.back();
+            key.series = span(tokens, 0, tokens.size() - 1);
+        }
+        indexKey(key, k);
+        if (!_index.emplace(k, it).second)
+        {
+            throw my_error("Reference keys \"" + _index.at(k)->first + "\" and \"" + it->first + "\" name the same sample");
+        }
+    }
+}
+
+ChemIterator SampleIndex::find(const SampleKey &key) const
+{
+    if (key.kind == SampleKind::Other)
+    {
+        return _chem->end();
+    }
+    thread_local std::string k;
+    indexKey(key, k);
+    const auto it{_index.find(k)};
+    return it == _index.end() ? _chem->end() : it->second;
+}
+
+SampleMatcher::SampleMatcher(const SampleIndex &index, const std::vector<SampleKind> &kinds)
+    : _chem{&index.chem()}, _index{&index}, _kinds{kinds}
+{
+}
+
+SampleMatcher::SampleMatcher(const std::map<std::string, ChemResult> &chem, const std::regex &pattern)
+    : _chem{&chem}, _pattern{pattern}
+{
+}
+
+ChemIterator SampleMatcher::match(std::string_view name) const
+{
+    if (_index == nullptr)
+    {
+        return findChem(name, *_chem, _pattern);
+    }
+    const auto key{parseSampleKey(name)};
+    if (std::find(_kinds.begin(), _kinds.end(), key.kind) == _kinds.end())
+    {
+        return _chem->end();
+    }
+    if (key.kind == SampleKind::Grad && !singleDigitReplicate(name))
+    {
+        return _chem->end();
+    }
+    return _index->find(key);
+}
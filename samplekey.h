@@ -0,0 +1,88 @@
+#ifndef SAMPLEKEY_H
+#define SAMPLEKEY_H
+
+#include "common.h"
+
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using ChemIterator = std::map<std::string, ChemResult>::const_iterator;
+
+enum class SampleKind {
+    Grad,   // replicate of a calibration sample, coal_grad_3834_1
+    Sum,    // sum of the replicates, coal_grad_3834_sum
+    Povtor, // repeatability series, coal_grad_3834_povtor_7
+    Blind,  // blind sample, barz_blind_309_310
+    Other
+};
+
+const char *sampleKindName(const SampleKind kind);
+
+// Throws my_error on an unknown name.
+SampleKind sampleKindFromString(const std::string &name);
+
+// Structure of a sample name, the part before the first '.' split on '_'. Views point into the name.
+//   coal_grad_3834_1.substracted.forEachGamma      - coal, Grad, id 3834, replicate 1
+//   coal_grad_bereza_5_povtor_3.substracted        - coal, Povtor, series bereza, id 5, replicate 3
+//   coal_grad_3834_sum.substracted                 - coal, Sum, id 3834
+//   barz_blind_309_310                             - barz, Blind, id 309_310
+// A grad name with neither a replicate number nor sum is Other.
+struct SampleKey {
+    SampleKind kind{SampleKind::Other};
+    std::string_view material;
+    std::string_view series;
+    std::string_view id;
+    std::optional<size_t> replicate;
+};
+
+SampleKey parseSampleKey(std::string_view name);
+
+// The references of chem by the structure of their keys, so the reference of a name is one hash lookup
+// instead of a substring search over all keys. Keys are either names as parseSampleKey reads them
+// or short forms of a calibration sample: "3834" (id) and "bereza_1_" (series and id).
+// Throws my_error if two keys stand for the same sample. chem must outlive the index.
+class SampleIndex
+{
+public:
+    explicit SampleIndex(const std::map<std::string, ChemResult> &chem);
+
+    // Reference of key, chem().end() if there is none.
+    ChemIterator find(const SampleKey &key) const;
+    const std::map<std::string, ChemResult> &chem() const
+    {
+        return *_chem;
+    }
+private:
+    const std::map<std::string, ChemResult> *_chem;
+    std::unordered_map<std::string, ChemIterator> _index;
+};
+
+// Rows a dataset is made of. The default way selects by kind through a SampleIndex, Grad only with
+// a single-digit replicate as the regex \d+_\d\. did; the compatibility way is findChem with a regex
+// as before: key as substring of the name and pattern searched in it.
+class SampleMatcher
+{
+public:
+    SampleMatcher(const SampleIndex &index, const std::vector<SampleKind> &kinds);
+    SampleMatcher(const std::map<std::string, ChemResult> &chem, const std::regex &pattern);
+
+    // Reference of name, chem().end() if the row is not selected.
+    ChemIterator match(std::string_view name) const;
+    const std::map<std::string, ChemResult> &chem() const
+    {
+        return *_chem;
+    }
+private:
+    const std::map<std::string, ChemResult> *_chem;
+    const SampleIndex *_index{nullptr};
+    std::vector<SampleKind> _kinds;
+    std::regex _pattern;
+};
+
+#endif // SAMPLEKEY_H
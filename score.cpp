@@ -0,0 +1,252 @@
+// Scores rea.elts rows with a calibration saved by multipar --save-model, without ROOT and without fitting:
+//   score --model=file [--in=file,...] [--err] [--threads=N] [--filter=...] [--profile[=file]]
+// --in lists the inputs, "-" (the default) is standard input read line by line as it arrives.
+// Prints "name <target> [err]" and then one line per row, the rows of every input in order,
+// err is the standard error of the prediction from the model covariance. Line errors go to standard error.
+
+#include "common.h"
+#include "instrument.h"
+#include "mappedfile.h"
+#include "model.h"
+#include "options.h"
+#include "parser.h"
+#include "predict.h"
+#include "rowfilter.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t blockRows{4096};
+
+// Rows collected column by column and scored by predictBatch a block at a time.
+class BlockScorer
+{
+public:
+    BlockScorer(const CalibrationModel &model, const std::vector<size_t> &columns, const bool withErrors)
+        : _model{&model}, _columns{columns}, _withErrors{withErrors},
+          _values(columns.size(), std::vector<double>(blockRows)), _names(blockRows), _y(blockRows)
+    {
+    }
+
+    // Reads the model columns of strs, throws my_error on a field that is no number.
+    // Full blocks are scored to out.
+    void add(const std::vector<std::string_view> &strs, const size_t lineNumber, std::string &out)
+    {
+        for (size_t e{0}; e < _columns.size(); ++e)
+        {
+            _values[e][_n] = columnToDouble(strs, _columns[e], lineNumber);
+        }
+        _names[_n].assign(strs.front());
+        if (++_n == blockRows)
+        {
+            flush(out);
+        }
+    }
+
+    // Appends the lines of the collected rows to out.
+    void flush(std::string &out)
+    {
+        if (_n == 0)
+        {
+            return;
+        }
+        std::vector<const double *> columns;
+        for (const auto &v : _values)
+        {
+            columns.push_back(v.data());
+        }
+        predictBatch(_model->par, columns, _n, _y.data());
+        const auto nPar{_model->par.size()};
+        std::vector<double> x(nPar, 1.0);
+        char buffer[64];
+        for (size_t r{0}; r < _n; ++r)
+        {
+            out += _names[r];
+            auto len{std::snprintf(buffer, sizeof(buffer), " %.10g", _y[r])};
+            out.append(buffer, static_cast<size_t>(len));
+            if (_withErrors)
+            {
+                for (size_t e{0}; e + 1 < nPar; ++e)
+                {
+                    x[e] = _values[e][r];
+                }
+                auto var{0.0};
+                for (size_t i{0}; i < nPar; ++i)
+                {
+                    for (size_t j{0}; j < nPar; ++j)
+                    {
+                        var += x[i] * _model->cov[i * nPar + j] * x[j];
+                    }
+                }
+                len = std::snprintf(buffer, sizeof(buffer), " %.10g", std::sqrt(std::max(var, 0.0)));
+                out.append(buffer, static_cast<size_t>(len));
+            }
+            out += '\n';
+        }
+        countEvent(Counter::LinesMatched, _n);
+        _n = 0;
+    }
+private:
+    const CalibrationModel *_model;
+    std::vector<size_t> _columns;
+    bool _withErrors;
+    std::vector<std::vector<double>> _values; // element -> row of the block
+    std::vector<std::string> _names;
+    std::vector<double> _y;
+    size_t _n{0};
+};
+
+void write(const std::string &out)
+{
+    std::fwrite(out.data(), 1, out.size(), stdout);
+}
+
+// Standard input in the order it arrives, a block at a time.
+void scoreStream(const CalibrationModel &model, const RowFilter &filter, const bool withErrors)
+{
+    std::string line;
+    std::vector<std::string_view> strs;
+    size_t lineNumber{0};
+    auto header{false};
+    while (!header && std::getline(std::cin, line))
+    {
+        ++lineNumber;
+        header = splitLineToViews(line, strs) > 0;
+    }
+    // an empty input has no rows to score
+    if (!header)
+    {
+        return;
+    }
+    const auto columnElement{getColumnElement(strs, "-")};
+    const auto streamFilter{filter.forColumns(columnElement, "-")};
+    BlockScorer scorer(model, modelColumns(model, columnElement, "-"), withErrors);
+    std::string out;
+    while (std::getline(std::cin, line))
+    {
+        ++lineNumber;
+        if (splitLineToViews(line, strs) == 0 || strs.front() == "fileName" || !streamFilter.accept(strs))
+        {
+            continue;
+        }
+        try
+        {
+            scorer.add(strs, lineNumber, out);
+        }
+        catch (const my_error &err)
+        {
+            std::cerr << "Error: " << err.what() << std::endl;
+        }
+        // rows arriving together are scored together, a row waiting alone is scored at once
+        if (std::cin.rdbuf()->in_avail() <= 0)
+        {
+            scorer.flush(out);
+        }
+        if (!out.empty())
+        {
+            write(out);
+            std::fflush(stdout);
+            out.clear();
+        }
+    }
+    scorer.flush(out);
+    write(out);
+}
+
+// A mapped file scanned in chunks by the pool, the lines of the chunks written in file order.
+void scoreFile(const std::string &fileName,
+               const CalibrationModel &model,
+               const RowFilter &filter,
+               const bool withErrors,
+               ThreadPool &pool,
+               const unsigned int threads)
+{
+    const auto columnElement{getColumnElement(fileName)};
+    const auto fileFilter{filter.forColumns(columnElement, fileName)};
+    const auto columns{modelColumns(model, columnElement, fileName)};
+    MappedFile file(fileName);
+    const auto chunks{splitTextToChunks(file.data(), chunkCount(file.size(), threads))};
+    std::vector<BlockScorer> scorers(chunks.size(), BlockScorer(model, columns, withErrors));
+    std::vector<std::string> out(chunks.size());
+    std::vector<std::vector<std::string>> errors(chunks.size());
+    scanChunks(chunks, pool, [&](size_t i, size_t lineNumber, const std::vector<std::string_view> &strs){
+        if (strs.front() == "fileName" || !fileFilter.accept(strs))
+        {
+            return;
+        }
+        try
+        {
+            scorers[i].add(strs, lineNumber, out[i]);
+        }
+        catch (const my_error &err)
+        {
+            errors[i].push_back(err.what());
+        }
+    });
+    for (size_t i{0}; i < chunks.size(); ++i)
+    {
+        for (const auto &error : errors[i])
+        {
+            std::cerr << "Error: " << error << std::endl;
+        }
+        scorers[i].flush(out[i]);
+        write(out[i]);
+    }
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        // std::cin buffers on its own, so in_avail tells whether more input is already there
+        std::ios::sync_with_stdio(false);
+        Options options(argc, argv);
+        ProfileAtExit profile(options.has("profile"), options.get("profile"));
+        if (!options.has("model"))
+        {
+            throw my_error("No --model=file");
+        }
+        const auto model{readModel(options.get("model"))};
+        const auto withErrors{options.has("err")};
+        if (withErrors && model.cov.empty())
+        {
+            throw my_error("--err: the model has no covariance");
+        }
+        const RowFilter filter(options.getList("filter", {}));
+        const auto threads{defaultThreads(options.getUInt("threads", 0))};
+        ThreadPool pool(threads - 1);
+
+        StageTimer timer("score");
+        std::string header{"name "};
+        header += model.target == Data1::Value::A ? "A" : "W";
+        header += withErrors ? " err\n" : "\n";
+        write(header);
+        for (const auto &input : options.getList("in", { "-" }))
+        {
+            if (input == "-")
+            {
+                scoreStream(model, filter, withErrors);
+            }
+            else
+            {
+                scoreFile(input, model, filter, withErrors, pool, threads);
+            }
+        }
+        std::fflush(stdout);
+    }
+    catch (const std::exception &err)
+    {
+        std::cerr << "Error: " << err.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
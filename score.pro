@@ -0,0 +1,39 @@
+# Scores rows with a model saved by multipar --save-model, see score.cpp.
+# Only the parsing and prediction code, no ROOT.
+TEMPLATE = app
+TARGET = score
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+CONFIG -= qt
+
+LIBS += -pthread
+
+no_instrument: DEFINES += MULTIPAR_NO_INSTRUMENT
+
+SOURCES += \
+        dataset.cpp \
+        instrument.cpp \
+        lsq.cpp \
+        mappedfile.cpp \
+        model.cpp \
+        options.cpp \
+        parser.cpp \
+        predict.cpp \
+        rowfilter.cpp \
+        samplekey.cpp \
+        score.cpp
+
+HEADERS += \
+        common.h \
+        dataset.h \
+        instrument.h \
+        lsq.h \
+        mappedfile.h \
+        model.h \
+        options.h \
+        parser.h \
+        predict.h \
+        rowfilter.h \
+        samplekey.h \
+        threadpool.h
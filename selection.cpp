@@ -0,0 +1,188 @@
+#include "selection.h"
+#include "instrument.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+Criterion criterionFromString(const std::string &str)
+{
+    if (str == "cv")
+    {
+        return Criterion::CV;
+    }
+    if (str == "aic")
+    {
+        return Criterion::AIC;
+    }
+    if (str == "bic")
+    {
+        return Criterion::BIC;
+    }
+    throw my_error("Unknown criterion \"" + str + "\", expected cv, aic or bic");
+}
+
+double SubsetResult::score(const Criterion criterion) const
+{
+    switch (criterion) {
+    case Criterion::CV:
+        return cvRmse;
+    case Criterion::AIC:
+        return aic;
+    case Criterion::BIC:
+        return bic;
+    }
+    return cvRmse;
+}
+
+namespace {
+
+const size_t maxSubsets{10000000};
+
+}
+
+std::vector<SubsetResult> searchSubsets(const Dataset &data,
+                                        const Data1::Value value,
+                                        const size_t maxElements,
+                                        const Criterion criterion,
+                                        const double yErr,
+                                        const unsigned int nThreads)
+{
+    StageTimer timer("select");
+    const auto nElements{data.elements.size()};
+    if (nElements == 0 || nElements > 63)
+    {
+        throw my_error("searchSubsets: " + std::to_string(nElements) + " elements, expected 1 to 63");
+    }
+    const auto w{1.0 / (yErr * yErr)};
+    const auto rows{data.rowsWith(value)};
+    if (rows.empty())
+    {
+        throw my_error("searchSubsets: no rows with a reference value");
+    }
+
+    // normal equations of every sample and of all rows
+    std::vector<NormalEquations> sampleNe;
+    for (size_t first{0}; first < rows.size();)
+    {
+        auto last{first};
+        while (last < rows.size() && data.rowSample[rows[last]] == data.rowSample[rows[first]])
+        {
+            ++last;
+        }
+        sampleNe.push_back(normalEquations(data, std::vector<size_t>(rows.begin() + static_cast<long>(first),
+                                                                     rows.begin() + static_cast<long>(last)), value, w));
+        first = last;
+    }
+    NormalEquations total;
+    for (const auto &ne : sampleNe)
+    {
+        total += ne;
+    }
+
+    std::vector<std::uint64_t> masks;
+    for (size_t k{1}; k <= std::min(maxElements, nElements); ++k)
+    {
+        // all k-bit masks below 2^nElements in increasing order
+        for (auto m{(std::uint64_t{1} << k) - 1}; m < (std::uint64_t{1} << nElements);)
+        {
+            masks.push_back(m);
+            if (masks.size() > maxSubsets)
+            {
+                throw my_error("searchSubsets: more than " + std::to_string(maxSubsets) + " subsets, lower the subset size");
+            }
+            auto c{m & (~m + 1)};
+            auto r{m + c};
+            m = (((r ^ m) >> 2) / c) | r;
+        }
+    }
+
+    std::vector<SubsetResult> results(masks.size());
+    std::vector<char> ok(masks.size(), 0);
+    const auto n{static_cast<double>(total.n)};
+    ThreadPool pool(defaultThreads(nThreads) - 1);
+    pool.parallelFor(masks.size(), [&](size_t i){
+        auto &r{results[i]};
+        std::vector<size_t> idx;
+        for (size_t e{0}; e < nElements; ++e)
+        {
+            if (masks[i] & (std::uint64_t{1} << e))
+            {
+                r.elements.push_back(e);
+                idx.push_back(e);
+            }
+        }
+        idx.push_back(nElements);
+        const auto sub{total.subset(idx)};
+        const auto p{idx.size()};
+        if (sub.n <= p)
+        {
+            return;
+        }
+        try
+        {
+            r.fit = solveNormalEquations(sub);
+        }
+        catch (const my_error &)
+        {
+            return;
+        }
+        const auto rss{r.fit.chi2 / sub.sumW * n};
+        r.rmse = std::sqrt(rss / n);
+        r.aic = n * std::log(rss / n) + 2.0 * static_cast<double>(p);
+        r.bic = n * std::log(rss / n) + std::log(n) * static_cast<double>(p);
+
+        auto sse{0.0};
+        auto sumW{0.0};
+        for (const auto &ne : sampleNe)
+        {
+            auto trainNe{sub};
+            const auto testNe{ne.subset(idx)};
+            trainNe -= testNe;
+            auto l{trainNe.xtx};
+            if (trainNe.n < p || !choleskyDecompose(l, p))
+            {
+                sse = std::numeric_limits<double>::infinity();
+                break;
+            }
+            auto par{trainNe.xty};
+            choleskySolve(l, p, par);
+            sse += testNe.chi2(par);
+            sumW += testNe.sumW;
+        }
+        r.cvRmse = std::sqrt(sse / sumW);
+        ok[i] = 1;
+    });
+
+    std::vector<SubsetResult> sorted;
+    for (size_t i{0}; i < results.size(); ++i)
+    {
+        if (ok[i])
+        {
+            sorted.push_back(std::move(results[i]));
+        }
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [criterion](const SubsetResult &a, const SubsetResult &b){
+        return a.score(criterion) < b.score(criterion);
+    });
+    return sorted;
+}
+
+void printSubsets(const std::vector<SubsetResult> &subsets,
+                  const Dataset &data,
+                  const size_t top)
+{
+    std::cout << "subsets: " << subsets.size() << std::endl;
+    for (size_t i{0}; i < std::min(top, subsets.size()); ++i)
+    {
+        const auto &s{subsets[i]};
+        std::cout << i + 1 << ": cvRmse = " << s.cvRmse << " rmse = " << s.rmse
+                  << " aic = " << s.aic << " bic = " << s.bic << " [";
+        for (size_t j{0}; j < s.elements.size(); ++j)
+        {
+            std::cout << " " << data.elements[s.elements[j]] << "=" << s.fit.par[j];
+        }
+        std::cout << " const=" << s.fit.par.back() << " ]" << std::endl;
+    }
+}
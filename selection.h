@@ -0,0 +1,45 @@
+#ifndef SELECTION_H
+#define SELECTION_H
+
+#include "dataset.h"
+#include "lsq.h"
+
+#include <limits>
+
+enum class Criterion {
+    CV,
+    AIC,
+    BIC
+};
+
+// "cv", "aic" or "bic"
+Criterion criterionFromString(const std::string &str);
+
+struct SubsetResult {
+    std::vector<size_t> elements; // dataset element indices
+    LinearFit fit;                // parameters of elements, intercept last
+    double rmse{0.0};             // on the fitted rows
+    double cvRmse{std::numeric_limits<double>::infinity()}; // leave one sample out
+    double aic{0.0};
+    double bic{0.0};
+    double score(const Criterion criterion) const;
+};
+
+// Fits every subset of 1..maxElements elements of data plus an intercept to the reference value.
+// The normal equations of all elements are built once for the whole data and once per sample,
+// every subset is then a small Cholesky solve on the selected rows and columns, and
+// leave-one-sample-out is done by subtracting the sample's normal equations.
+// Parameter limits are not applied. Subsets with singular normal equations are skipped.
+// The result is sorted by criterion, best first.
+std::vector<SubsetResult> searchSubsets(const Dataset &data,
+                                        const Data1::Value value,
+                                        const size_t maxElements,
+                                        const Criterion criterion,
+                                        const double yErr,
+                                        const unsigned int nThreads = 0);
+
+void printSubsets(const std::vector<SubsetResult> &subsets,
+                  const Dataset &data,
+                  const size_t top);
+
+#endif // SELECTION_H
@@ -0,0 +1,111 @@
+#include "stream.h"
+#include "parser.h"
+#include "tailreader.h"
+
+#include <chrono>
+#include <thread>
+
+StreamCalibration calibrate(const Dataset &data,
+                            const Data1::Value value,
+                            const std::map<size_t, ParLimits> &limits,
+                            const double yErr,
+                            const double forgetting)
+{
+    const auto rows{data.rowsWith(value)};
+    std::vector<double> y;
+    for (auto row : rows)
+    {
+        y.push_back(data.reference(row, value).value());
+    }
+    auto fit{fitLinear(data.design(rows), y, std::vector<double>(y.size(), 1.0 / (yErr * yErr)), limits)};
+    return { value, RecursiveLeastSquares(fit, limits, forgetting) };
+}
+
+void followFile(const std::string &fileName,
+                const std::map<int, std::string> &columnElement,
+                const std::map<std::string, ChemResult> &chem,
+                const std::regex &pattern,
+                std::vector<StreamCalibration> &calibrations,
+                const double yErr,
+                const unsigned int pollMs,
+                const unsigned int idleSeconds,
+                const RowFilter &filter)
+{
+    followFile(fileName, columnElement, SampleMatcher(chem, pattern), calibrations, yErr, pollMs, idleSeconds, filter);
+}
+
+void followFile(const std::string &fileName,
+                const std::map<int, std::string> &columnElement,
+                const SampleMatcher &matcher,
+                std::vector<StreamCalibration> &calibrations,
+                const double yErr,
+                const unsigned int pollMs,
+                const unsigned int idleSeconds,
+                const RowFilter &filter)
+{
+    const auto fileFilter{filter.forColumns(columnElement, fileName)};
+    TailReader reader(fileName, true);
+    const auto w{1.0 / (yErr * yErr)};
+    std::vector<std::string> lines;
+    std::vector<std::string_view> strs;
+    std::vector<double> values;
+    std::vector<double> x(columnElement.size() + 1, 1.0);
+    auto lastData{std::chrono::steady_clock::now()};
+    std::cout << "following \"" << fileName << "\" from line " << reader.lineNumber() + 1 << std::endl;
+
+    for (;;)
+    {
+        auto lineNumber{reader.lineNumber()};
+        if (!reader.poll(lines))
+        {
+            if (idleSeconds > 0 && std::chrono::steady_clock::now() - lastData >= std::chrono::seconds(idleSeconds))
+            {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(pollMs));
+            continue;
+        }
+        lastData = std::chrono::steady_clock::now();
+        for (const auto &line : lines)
+        {
+            ++lineNumber;
+            if (splitLineToViews(line, strs) == 0 || strs.front() == "fileName" || !fileFilter.accept(strs))
+            {
+                continue;
+            }
+            try
+            {
+                getValuesFromLine(strs, columnElement, lineNumber, values);
+            }
+            catch (const my_error& err)
+            {
+                std::cout << "Error: " << err.what() << std::endl;
+                continue;
+            }
+            for (size_t e{0}; e + 1 < x.size(); ++e)
+            {
+                x[e] = values[2 * e];
+            }
+
+            std::cout << strs.front() << ":";
+            for (const auto &c : calibrations)
+            {
+                std::cout << " " << (c.value == Data1::Value::A ? "A" : "W") << " = " << c.rls.predict(x.data());
+            }
+            auto it{matcher.match(strs.front())};
+            if (it != matcher.chem().end())
+            {
+                for (auto &c : calibrations)
+                {
+                    auto v{getReference(it->second, c.value)};
+                    if (v.has_value())
+                    {
+                        c.rls.update(x.data(), v.value(), w);
+                        std::cout << ", " << (c.value == Data1::Value::A ? "A" : "W") << " recalibrated on " << v.value();
+                    }
+                }
+            }
+            std::cout << std::endl;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "dataset.h"
+#include "lsq.h"
+#include "rowfilter.h"
+#include "samplekey.h"
+
+#include <map>
+#include <regex>
+#include <string>
+#include <vector>
+
+struct StreamCalibration {
+    Data1::Value value;
+    RecursiveLeastSquares rls;
+};
+
+// Starting point of a stream: the bounded fit of value on all rows of data with a reference value.
+StreamCalibration calibrate(const Dataset &data,
+                            const Data1::Value value,
+                            const std::map<size_t, ParLimits> &limits,
+                            const double yErr,
+                            const double forgetting = 1.0);
+
+// Follows fileName from its current end. Every appended row gets a prediction from each calibration,
+// rows matching chem and pattern then update the calibrations that have a reference for them.
+// The file is polled every pollMs milliseconds, idleSeconds without new rows end the loop (0 - never).
+// Rows filter does not accept are skipped.
+void followFile(const std::string &fileName,
+                const std::map<int, std::string> &columnElement,
+                const std::map<std::string, ChemResult> &chem,
+                const std::regex &pattern,
+                std::vector<StreamCalibration> &calibrations,
+                const double yErr,
+                const unsigned int pollMs = 1000,
+                const unsigned int idleSeconds = 0,
+                const RowFilter &filter = {});
+
+// followFile with the reference rows selected by matcher.
+void followFile(const std::string &fileName,
+                const std::map<int, std::string> &columnElement,
+                const SampleMatcher &matcher,
+                std::vector<StreamCalibration> &calibrations,
+                const double yErr,
+                const unsigned int pollMs = 1000,
+                const unsigned int idleSeconds = 0,
+                const RowFilter &filter = {});
+
+#endif // STREAM_H
@@ -0,0 +1,142 @@
+#include "synthetic.h"
+
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <random>
+
+std::vector<std::string> syntheticElements(const size_t n)
+{
+    const std::vector<std::string> known{"Al", "C", "N", "O", "Si", "Mg", "Ca", "Fe", "S", "K", "Na", "Ti", "P", "Cl", "Mn"};
+    std::vector<std::string> elements;
+    for (size_t i{0}; i < n; ++i)
+    {
+        elements.push_back(i < known.size() ? known[i] : "X" + std::to_string(i));
+    }
+    return elements;
+}
+
+std::map<std::string, ChemResult> syntheticChem(const SyntheticSpec &spec)
+{
+    std::mt19937_64 gen(spec.seed);
+    std::uniform_real_distribution<double> uniform(4.0, 8.0);
+    std::map<std::string, ChemResult> chem;
+    for (size_t s{0}; s < spec.samples; ++s)
+    {
+        const auto a{7.8 + 25.0 * static_cast<double>(s) / static_cast<double>(spec.samples)};
+        chem[std::to_string(3834 + s)] = ChemResult{a, uniform(gen)};
+    }
+    return chem;
+}
+
+void writeSyntheticElts(const std::string &fileName, const SyntheticSpec &spec)
+{
+    if (spec.elements < 2 || spec.samples == 0 || spec.replicates == 0 || spec.replicates > 9)
+    {
+        throw my_error("Wrong synthetic spec: elements >= 2, samples > 0 and replicates 1..9 are expected");
+    }
+    if (spec.rows < spec.samples)
+    {
+        throw my_error("Wrong synthetic spec: at least one row per sample is expected");
+    }
+    const auto elements{syntheticElements(spec.elements)};
+    std::mt19937_64 gen(spec.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    // C, N and O make the organic part, everything else is ash split by fixed shares
+    const auto isOrganic{[&elements](const size_t e)
+    {
+        return elements[e] == "C" || elements[e] == "N" || elements[e] == "O";
+    }};
+    std::vector<double> ashShare(spec.elements, 0.0);
+    std::vector<double> error(spec.elements);
+    for (size_t e{0}; e < spec.elements; ++e)
+    {
+        ashShare[e] = isOrganic(e) ? 0.0 : 0.5 + uniform(gen);
+        error[e] = 0.2 + 0.25 * uniform(gen);
+    }
+    const auto shareSum{std::accumulate(ashShare.begin(), ashShare.end(), 0.0)};
+
+    const auto chem{syntheticChem(spec)};
+    std::vector<std::string> keys;
+    std::vector<std::vector<double>> composition;
+    for (size_t s{0}; s < spec.samples; ++s)
+    {
+        keys.push_back(std::to_string(3834 + s));
+        const auto a{chem.at(keys.back()).a.value()};
+        std::vector<double> c(spec.elements, 0.0);
+        auto rest{100.0};
+        for (size_t e{0}; e < spec.elements; ++e)
+        {
+            if (shareSum > 0.0)
+            {
+                c[e] = 0.3 * a * ashShare[e] / shareSum;
+            }
+            if (elements[e] == "N")
+            {
+                c[e] = 3.0;
+            }
+            else if (elements[e] == "O")
+            {
+                c[e] = 15.0;
+            }
+            rest -= c[e];
+        }
+        for (size_t e{0}; e < spec.elements; ++e)
+        {
+            if (elements[e] == "C")
+            {
+                c[e] += rest;
+            }
+        }
+        composition.push_back(c);
+    }
+
+    std::ofstream out(fileName);
+    if (!out)
+    {
+        throw my_error("Can't write file " + fileName);
+    }
+    out << "fileName";
+    for (const auto &element : elements)
+    {
+        out << " " << element << " err";
+    }
+    out << "\n";
+
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::vector<double> v(spec.elements);
+    char buffer[64];
+    const auto writeRow{[&](const size_t s, const std::string &suffix)
+    {
+        auto sum{0.0};
+        for (size_t e{0}; e < spec.elements; ++e)
+        {
+            v[e] = std::max(0.0, composition[s][e] + error[e] * noise(gen));
+            sum += v[e];
+        }
+        out << "coal_grad_" << keys[s] << "_" << suffix << ".substracted.forEachGamma ";
+        for (size_t e{0}; e < spec.elements; ++e)
+        {
+            std::snprintf(buffer, sizeof(buffer), "\t%9g\t%8g", 100.0 * v[e] / sum, error[e]);
+            out << buffer;
+        }
+        std::snprintf(buffer, sizeof(buffer), "\t%g %g 10 0 0\n", 1.2 + 0.1 * uniform(gen), 1.25 + 0.02 * uniform(gen));
+        out << buffer;
+    }};
+
+    const auto measured{spec.rows - spec.samples};
+    for (size_t i{0}; i < measured; ++i)
+    {
+        const auto s{(i / spec.replicates) % spec.samples};
+        writeRow(s, std::to_string(i % spec.replicates + 1));
+    }
+    for (size_t s{0}; s < spec.samples; ++s)
+    {
+        writeRow(s, "sum");
+    }
+    if (!out)
+    {
+        throw my_error("Can't write file " + fileName);
+    }
+}
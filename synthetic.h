@@ -0,0 +1,34 @@
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include "common.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Shape of a generated rea.elts file, see writeSyntheticElts.
+struct SyntheticSpec {
+    size_t rows{1000};
+    size_t elements{5};
+    size_t samples{11};    // calibration samples coal_grad_3834, coal_grad_3835, ...
+    size_t replicates{3};  // measurements per sample in a row of the file, 1..9
+    std::uint64_t seed{1};
+};
+
+// Element names of a synthetic file with n elements: Al C N O Si first, as in rea.elts.txt.wo_MgCaFeS.all.
+std::vector<std::string> syntheticElements(const size_t n);
+
+// References of the samples of a synthetic file keyed by sample number, as the chem map of main.
+// They depend on the spec only, not on spec.rows.
+std::map<std::string, ChemResult> syntheticChem(const SyntheticSpec &spec);
+
+// Writes spec.rows rows in the format of rea.elts: the header "fileName El err ...", then
+// "coal_grad_<key>_<replicate>.substracted.forEachGamma value error ..." and the 5 trailing columns,
+// the last spec.samples rows are the "_sum" rows of the samples.
+// Every row sums to 100% with measurement noise on top of its sample composition, and A of a sample
+// is linear in its ash elements (the A of syntheticChem), so the calibration of the file is well posed.
+void writeSyntheticElts(const std::string &fileName, const SyntheticSpec &spec);
+
+#endif // SYNTHETIC_H
@@ -0,0 +1,365 @@
+#include "tablecache.h"
+#include "instrument.h"
+#include "mappedfile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <sys/stat.h>
+
+namespace {
+
+const char cacheMagic[8]{'M', 'P', 'T', 'A', 'B', 'L', 'E', '\0'};
+const std::uint32_t cacheVersion{1};
+
+struct SourceStat {
+    std::uint64_t size{0};
+    std::int64_t mtimeSec{0};
+    std::int64_t mtimeNsec{0};
+};
+
+struct CacheHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t nBlocks;
+    std::uint64_t sourceSize;
+    std::int64_t sourceMtimeSec;
+    std::int64_t sourceMtimeNsec;
+    std::uint64_t nRows;
+    std::uint32_t nElements;
+    std::uint32_t nExtra;
+    std::uint64_t checksum; // of the header before this field and of the directory
+};
+
+struct CacheBlock {
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::uint64_t checksum;
+};
+
+// block order, followed by nElements values, nElements errors and nExtra trailing columns
+enum Block : size_t {
+    ElementNames,
+    NameChars,
+    NameOffsets,
+    Parts,
+    PartBegin,
+    FirstColumn
+};
+
+std::optional<SourceStat> sourceStat(const std::string &fileName)
+{
+    struct stat st;
+    if (::stat(fileName.c_str(), &st) != 0)
+    {
+        return std::nullopt;
+    }
+    return SourceStat{ static_cast<std::uint64_t>(st.st_size),
+                       static_cast<std::int64_t>(st.st_mtim.tv_sec),
+                       static_cast<std::int64_t>(st.st_mtim.tv_nsec) };
+}
+
+std::uint64_t checksum(const char *data, const size_t size, std::uint64_t h = 0xcbf29ce484222325ull)
+{
+    const std::uint64_t prime{0x100000001b3ull};
+    size_t i{0};
+    for (; i + 8 <= size; i += 8)
+    {
+        std::uint64_t w;
+        std::memcpy(&w, data + i, 8);
+        h = (h ^ w) * prime;
+        h ^= h >> 29;
+    }
+    for (; i < size; ++i)
+    {
+        h = (h ^ static_cast<unsigned char>(data[i])) * prime;
+    }
+    return h;
+}
+
+std::uint64_t headerChecksum(const CacheHeader &header, const CacheBlock *blocks)
+{
+    auto h{checksum(reinterpret_cast<const char *>(&header), offsetof(CacheHeader, checksum))};
+    return checksum(reinterpret_cast<const char *>(blocks), header.nBlocks * sizeof(CacheBlock), h);
+}
+
+// a cache block that does not verify, the cache is then ignored
+struct DamagedCache {
+    std::string what;
+};
+
+template <typename T>
+std::vector<T> readBlock(const std::string_view data, const CacheBlock &block)
+{
+    std::vector<T> v(block.size / sizeof(T));
+    std::memcpy(v.data(), data.data() + block.offset, v.size() * sizeof(T));
+    return v;
+}
+
+void writeCache(const std::string &fileName, const Table &table, const SourceStat &source)
+{
+    StageTimer timer("cache.save");
+    std::vector<std::string> blocks;
+    auto add = [&blocks](const void *data, const size_t size){
+        blocks.emplace_back(static_cast<const char *>(data), size);
+    };
+
+    std::string elementNames;
+    for (const auto &element : table.elements)
+    {
+        elementNames += element;
+        elementNames += '\0';
+    }
+    add(elementNames.data(), elementNames.size());
+    std::string chars;
+    std::vector<std::uint64_t> offsets{0};
+    for (const auto &name : table.names)
+    {
+        chars += name;
+        offsets.push_back(chars.size());
+    }
+    add(chars.data(), chars.size());
+    add(offsets.data(), offsets.size() * sizeof(std::uint64_t));
+    add(table.parts.data(), table.parts.size() * sizeof(Table::NamePart));
+    add(table.partBegin.data(), table.partBegin.size() * sizeof(std::uint64_t));
+    for (const auto &columns : { &table.values, &table.errors, &table.extra })
+    {
+        for (const auto &column : *columns)
+        {
+            add(column.data(), column.size() * sizeof(double));
+        }
+    }
+
+    CacheHeader header{};
+    std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = cacheVersion;
+    header.nBlocks = static_cast<std::uint32_t>(blocks.size());
+    header.sourceSize = source.size;
+    header.sourceMtimeSec = source.mtimeSec;
+    header.sourceMtimeNsec = source.mtimeNsec;
+    header.nRows = table.rows();
+    header.nElements = static_cast<std::uint32_t>(table.elements.size());
+    header.nExtra = static_cast<std::uint32_t>(table.extra.size());
+    std::vector<CacheBlock> directory;
+    auto offset{sizeof(header) + blocks.size() * sizeof(CacheBlock)};
+    for (const auto &b : blocks)
+    {
+        offset = (offset + 7) / 8 * 8;
+        directory.push_back({ offset, b.size(), checksum(b.data(), b.size()) });
+        offset += b.size();
+    }
+    header.checksum = headerChecksum(header, directory.data());
+
+    // written aside and renamed, so a reader never sees a half-written cache
+    const auto cacheName{tableCacheName(fileName)};
+    const auto tmpName{cacheName + ".tmp"};
+    {
+        std::ofstream ofs(tmpName, std::ios::binary | std::ios::trunc);
+        if (!ofs.is_open())
+        {
+            throw my_error("Can't open file \"" + tmpName + "\"");
+        }
+        ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        ofs.write(reinterpret_cast<const char *>(directory.data()), static_cast<std::streamsize>(directory.size() * sizeof(CacheBlock)));
+        auto pos{sizeof(header) + directory.size() * sizeof(CacheBlock)};
+        const char zeros[8]{};
+        for (size_t i{0}; i < blocks.size(); ++i)
+        {
+            ofs.write(zeros, static_cast<std::streamsize>(directory[i].offset - pos));
+            ofs.write(blocks[i].data(), static_cast<std::streamsize>(blocks[i].size()));
+            pos = directory[i].offset + blocks[i].size();
+        }
+        if (!ofs)
+        {
+            ofs.close();
+            std::remove(tmpName.c_str());
+            throw my_error("Can't write file \"" + tmpName + "\"");
+        }
+        countWritten(ofs);
+    }
+    if (std::rename(tmpName.c_str(), cacheName.c_str()) != 0)
+    {
+        std::remove(tmpName.c_str());
+        throw my_error("Can't rename \"" + tmpName + "\": " + std::strerror(errno));
+    }
+}
+
+}
+
+std::string tableCacheName(const std::string &fileName)
+{
+    return fileName + ".cache";
+}
+
+std::optional<Table> loadTableCache(const std::string &fileName, const std::vector<std::string> &elements)
+{
+    StageTimer timer("cache.load");
+    const auto source{sourceStat(fileName)};
+    const auto cacheName{tableCacheName(fileName)};
+    if (!source.has_value() || !sourceStat(cacheName).has_value())
+    {
+        return std::nullopt;
+    }
+    MappedFile file(cacheName);
+    const auto data{file.data()};
+    CacheHeader header;
+    if (data.size() < sizeof(header))
+    {
+        return std::nullopt;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != cacheVersion
+            || header.sourceSize != source->size || header.sourceMtimeSec != source->mtimeSec
+            || header.sourceMtimeNsec != source->mtimeNsec
+            || header.nBlocks != FirstColumn + 2ull * header.nElements + header.nExtra
+            || data.size() < sizeof(header) + header.nBlocks * sizeof(CacheBlock))
+    {
+        return std::nullopt;
+    }
+    const auto blocks{readBlock<CacheBlock>(data, { sizeof(header), header.nBlocks * sizeof(CacheBlock), 0 })};
+    if (headerChecksum(header, blocks.data()) != header.checksum)
+    {
+        std::cout << "\"" << cacheName << "\" is damaged, rereading \"" << fileName << "\"" << std::endl;
+        return std::nullopt;
+    }
+    auto verified = [&](size_t i){
+        const auto &b{blocks[i]};
+        if (b.offset > data.size() || b.size > data.size() - b.offset
+                || checksum(data.data() + b.offset, b.size) != b.checksum)
+        {
+            throw DamagedCache{ "block " + std::to_string(i) };
+        }
+        return b;
+    };
+
+    Table table;
+    try
+    {
+        std::vector<std::string> all;
+        const auto names{readBlock<char>(data, verified(ElementNames))};
+        for (auto p{names.begin()}; p != names.end();)
+        {
+            auto end{std::find(p, names.end(), '\0')};
+            all.emplace_back(p, end);
+            p = end == names.end() ? end : end + 1;
+        }
+        if (all.size() != header.nElements)
+        {
+            throw DamagedCache{ "element names" };
+        }
+        std::vector<size_t> columns;
+        for (const auto &element : elements.empty() ? all : elements)
+        {
+            auto it{std::find(all.begin(), all.end(), element)};
+            if (it == all.end())
+            {
+                throw my_error("No element \"" + element + "\" in \"" + fileName + "\"");
+            }
+            columns.push_back(static_cast<size_t>(it - all.begin()));
+            table.elements.push_back(element);
+        }
+
+        const auto &chars{verified(NameChars)};
+        const auto offsets{readBlock<std::uint64_t>(data, verified(NameOffsets))};
+        if (offsets.size() != header.nRows + 1 || offsets.back() != chars.size)
+        {
+            throw DamagedCache{ "name offsets" };
+        }
+        table.names.reserve(header.nRows);
+        for (size_t row{0}; row < header.nRows; ++row)
+        {
+            table.names.emplace_back(data.substr(chars.offset + offsets[row], offsets[row + 1] - offsets[row]));
+        }
+        table.parts = readBlock<Table::NamePart>(data, verified(Parts));
+        table.partBegin = readBlock<std::uint64_t>(data, verified(PartBegin));
+        if (table.partBegin.size() != header.nRows + 1 || table.partBegin.back() != table.parts.size())
+        {
+            throw DamagedCache{ "name parts" };
+        }
+        for (auto c : columns)
+        {
+            table.values.push_back(readBlock<double>(data, verified(FirstColumn + c)));
+            table.errors.push_back(readBlock<double>(data, verified(FirstColumn + header.nElements + c)));
+        }
+        for (size_t k{0}; k < header.nExtra; ++k)
+        {
+            table.extra.push_back(readBlock<double>(data, verified(FirstColumn + 2 * header.nElements + k)));
+        }
+        for (const auto &column : table.values)
+        {
+            if (column.size() != header.nRows)
+            {
+                throw DamagedCache{ "column size" };
+            }
+        }
+        table.sources = { fileName };
+        table.rowSource.assign(header.nRows, 0);
+    }
+    catch (const DamagedCache &err)
+    {
+        std::cout << "\"" << cacheName << "\" is damaged (" << err.what << "), rereading \"" << fileName << "\"" << std::endl;
+        return std::nullopt;
+    }
+    return table;
+}
+
+void saveTableCache(const std::string &fileName, const Table &table)
+{
+    const auto source{sourceStat(fileName)};
+    if (!source.has_value())
+    {
+        throw my_error("Can't stat file \"" + fileName + "\"");
+    }
+    writeCache(fileName, table, source.value());
+}
+
+Table readTableCached(const std::string &fileName,
+                      const std::vector<std::string> &elements,
+                      const unsigned int nThreads)
+{
+    auto cached{loadTableCache(fileName, elements)};
+    if (cached.has_value())
+    {
+        return std::move(cached.value());
+    }
+    // the stat taken before parsing makes a cache of a file changed meanwhile stale on the next run
+    const auto source{sourceStat(fileName)};
+    auto table{readTable(fileName, nThreads)};
+    if (source.has_value())
+    {
+        try
+        {
+            writeCache(fileName, table, source.value());
+        }
+        catch (const my_error &err)
+        {
+            std::cout << "Warning: " << err.what() << ", continuing without cache" << std::endl;
+        }
+    }
+    if (!elements.empty())
+    {
+        // the element columns are narrowed in place, so every other field of table (names, sources, ...) is kept
+        std::vector<std::vector<double>> values;
+        std::vector<std::vector<double>> errors;
+        for (const auto &element : elements)
+        {
+            auto it{std::find(table.elements.begin(), table.elements.end(), element)};
+            if (it == table.elements.end())
+            {
+                throw my_error("No element \"" + element + "\" in \"" + fileName + "\"");
+            }
+            const auto e{static_cast<size_t>(it - table.elements.begin())};
+            values.push_back(std::move(table.values[e]));
+            errors.push_back(std::move(table.errors[e]));
+        }
+        table.elements = elements;
+        table.values = std::move(values);
+        table.errors = std::move(errors);
+    }
+    return table;
+}
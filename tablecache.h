@@ -0,0 +1,30 @@
+#ifndef TABLECACHE_H
+#define TABLECACHE_H
+
+#include "dataset.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+// Binary sidecar of a Table, written next to the source as fileName + ".cache".
+// Layout (native byte order): a header with the version and the size and mtime of the source, a directory
+// of 8-byte aligned blocks with a checksum each, then one block per column - element names, name characters,
+// name offsets, name parts, part offsets, values and errors of every element, trailing numeric columns.
+// Blocks are read from a memory mapping, so only the columns asked for are touched and verified.
+
+std::string tableCacheName(const std::string &fileName);
+
+// Table of fileName from its cache restricted to elements (empty - all), std::nullopt if there is no cache,
+// it belongs to another version of the source or a block is damaged.
+std::optional<Table> loadTableCache(const std::string &fileName, const std::vector<std::string> &elements = {});
+
+// Writes the cache of table read from fileName, throws my_error if it can't be written.
+void saveTableCache(const std::string &fileName, const Table &table);
+
+// loadTableCache, or readTable followed by saveTableCache when the cache is missing or stale.
+Table readTableCached(const std::string &fileName,
+                      const std::vector<std::string> &elements = {},
+                      const unsigned int nThreads = 0);
+
+#endif // TABLECACHE_H
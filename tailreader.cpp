@@ -0,0 +1,128 @@
+#include "tailreader.h"
+#include "common.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t readBlockSize{1 << 20};
+
+class FileDescriptor
+{
+public:
+    explicit FileDescriptor(const std::string &fileName) : _fd{::open(fileName.c_str(), O_RDONLY)}
+    {
+        if (_fd < 0)
+        {
+            throw my_error("Can't open file \"" + fileName + "\"");
+        }
+    }
+    ~FileDescriptor()
+    {
+        ::close(_fd);
+    }
+    FileDescriptor(const FileDescriptor &) = delete;
+    FileDescriptor &operator=(const FileDescriptor &) = delete;
+    int get() const
+    {
+        return _fd;
+    }
+private:
+    int _fd;
+};
+
+std::uint64_t fileSize(const FileDescriptor &fd, const std::string &fileName)
+{
+    struct stat st;
+    if (::fstat(fd.get(), &st) != 0)
+    {
+        throw my_error("Can't stat file \"" + fileName + "\": " + std::strerror(errno));
+    }
+    return static_cast<std::uint64_t>(st.st_size);
+}
+
+// Reads [offset, end) in blocks and passes every block to onBlock.
+template <typename F>
+void readRange(const FileDescriptor &fd, const std::string &fileName, std::uint64_t offset, const std::uint64_t end, F onBlock)
+{
+    std::vector<char> buffer(static_cast<size_t>(std::min<std::uint64_t>(readBlockSize, end - offset)));
+    while (offset < end)
+    {
+        const auto n{::pread(fd.get(), buffer.data(), static_cast<size_t>(std::min<std::uint64_t>(buffer.size(), end - offset)),
+                             static_cast<off_t>(offset))};
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            throw my_error("Can't read file \"" + fileName + "\": " + (n < 0 ? std::strerror(errno) : "unexpected end"));
+        }
+        onBlock(buffer.data(), static_cast<size_t>(n));
+        offset += static_cast<std::uint64_t>(n);
+    }
+}
+
+}
+
+TailReader::TailReader(const std::string &fileName, const bool fromEnd) : _fileName{fileName}
+{
+    FileDescriptor fd(_fileName);
+    if (fromEnd)
+    {
+        // stop after the last complete line, a line being written is returned once it is finished
+        _offset = fileSize(fd, _fileName);
+        std::uint64_t lastNewline{0};
+        std::uint64_t pos{0};
+        readRange(fd, _fileName, 0, _offset, [this, &pos, &lastNewline](const char *data, size_t n){
+            for (size_t i{0}; i < n; ++i)
+            {
+                if (data[i] == '\n')
+                {
+                    ++_lineNumber;
+                    lastNewline = pos + i + 1;
+                }
+            }
+            pos += n;
+        });
+        _offset = lastNewline;
+    }
+}
+
+bool TailReader::poll(std::vector<std::string> &lines)
+{
+    lines.clear();
+    FileDescriptor fd(_fileName);
+    const auto size{fileSize(fd, _fileName)};
+    if (size < _offset)
+    {
+        std::cout << "\"" << _fileName << "\" was truncated, reading from the start" << std::endl;
+        _offset = 0;
+        _partial.clear();
+        _lineNumber = 0;
+    }
+    readRange(fd, _fileName, _offset, size, [this, &lines](const char *data, size_t n){
+        const auto *end{data + n};
+        for (const auto *p{data}; p != end;)
+        {
+            const auto *nl{std::find(p, end, '\n')};
+            _partial.append(p, nl);
+            if (nl == end)
+            {
+                break;
+            }
+            lines.push_back(std::move(_partial));
+            _partial.clear();
+            p = nl + 1;
+        }
+    });
+    _offset = size;
+    _lineNumber += lines.size();
+    return !lines.empty();
+}
@@ -0,0 +1,31 @@
+#ifndef TAILREADER_H
+#define TAILREADER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Follows a file that is being appended to: every poll reads only the bytes added since the last one
+// and returns the new complete lines, an unterminated last line is kept until its newline arrives.
+// A file that got shorter is taken as truncated and read again from the start.
+class TailReader
+{
+public:
+    // fromEnd - skip the current content, only lines appended later are returned
+    TailReader(const std::string &fileName, const bool fromEnd);
+
+    // Replaces lines with the new complete lines, returns false if there are none.
+    bool poll(std::vector<std::string> &lines);
+    // Number of complete lines of the file read or skipped so far.
+    size_t lineNumber() const
+    {
+        return _lineNumber;
+    }
+private:
+    std::string _fileName;
+    std::uint64_t _offset{0};
+    std::string _partial;
+    size_t _lineNumber{0};
+};
+
+#endif // TAILREADER_H
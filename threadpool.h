@@ -0,0 +1,214 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+inline unsigned int defaultThreads(const unsigned int nThreads)
+{
+    return nThreads > 0 ? nThreads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Fixed set of nWorkers threads executing submitted tasks in FIFO order,
+// without workers submit() runs the task in the calling thread.
+// Tasks must not wait for other tasks of the same pool.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(const unsigned int nWorkers)
+    {
+        for (unsigned int i{0}; i < nWorkers; ++i)
+        {
+            _workers.emplace_back([this](){ work(); });
+        }
+    }
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _cv.notify_all();
+        for (auto &t : _workers)
+        {
+            t.join();
+        }
+    }
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned int size() const
+    {
+        return static_cast<unsigned int>(_workers.size());
+    }
+
+    template <typename F>
+    auto submit(F f) -> std::future<decltype(f())>
+    {
+        auto task{std::make_shared<std::packaged_task<decltype(f())()>>(std::move(f))};
+        auto result{task->get_future()};
+        if (_workers.empty())
+        {
+            (*task)();
+            return result;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.emplace([task](){ (*task)(); });
+        }
+        _cv.notify_one();
+        return result;
+    }
+
+    // Calls f(i) for every i in [0, n) on the workers and the calling thread, rethrows the first exception.
+    // A pool of nThreads - 1 workers thus runs nThreads loops at once.
+    // Every loop owns an even share of the indices and, once it is done, steals the back half
+    // of the largest remaining share, so uneven tasks keep all threads busy.
+    template <typename F>
+    void parallelFor(const size_t n, F f)
+    {
+        const auto nLoops{std::min<size_t>(size() + 1, n)};
+        if (nLoops == 0)
+        {
+            return;
+        }
+        struct Range {
+            std::mutex mutex;
+            size_t begin;
+            size_t end;
+        };
+        std::vector<Range> ranges(nLoops);
+        for (size_t k{0}; k < nLoops; ++k)
+        {
+            ranges[k].begin = n * k / nLoops;
+            ranges[k].end = n * (k + 1) / nLoops;
+        }
+        std::atomic<bool> stop{false};
+
+        auto loop = [&ranges, &stop, &f, nLoops](size_t k){
+            auto &own{ranges[k]};
+            while (!stop)
+            {
+                size_t i;
+                {
+                    std::lock_guard<std::mutex> lock(own.mutex);
+                    i = own.begin < own.end ? own.begin++ : own.end;
+                    if (i == own.end)
+                    {
+                        i = std::numeric_limits<size_t>::max();
+                    }
+                }
+                if (i != std::numeric_limits<size_t>::max())
+                {
+                    f(i);
+                    continue;
+                }
+                size_t victim{nLoops};
+                size_t victimSize{0};
+                for (size_t v{0}; v < nLoops; ++v)
+                {
+                    std::lock_guard<std::mutex> lock(ranges[v].mutex);
+                    if (ranges[v].end - ranges[v].begin > victimSize)
+                    {
+                        victim = v;
+                        victimSize = ranges[v].end - ranges[v].begin;
+                    }
+                }
+                if (victim == nLoops)
+                {
+                    return;
+                }
+                size_t begin;
+                size_t end;
+                {
+                    std::lock_guard<std::mutex> lock(ranges[victim].mutex);
+                    end = ranges[victim].end;
+                    begin = ranges[victim].begin + (end - ranges[victim].begin) / 2;
+                    ranges[victim].end = begin;
+                }
+                std::lock_guard<std::mutex> lock(own.mutex);
+                own.begin = begin;
+                own.end = end;
+            }
+        };
+        auto guarded = [&loop, &stop](size_t k){
+            try
+            {
+                loop(k);
+            }
+            catch (...)
+            {
+                stop = true;
+                throw;
+            }
+        };
+
+        std::vector<std::future<void>> results;
+        for (size_t k{1}; k < nLoops; ++k)
+        {
+            results.push_back(submit([&guarded, k](){ guarded(k); }));
+        }
+        std::exception_ptr error;
+        try
+        {
+            guarded(0);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        for (auto &r : results)
+        {
+            try
+            {
+                r.get();
+            }
+            catch (...)
+            {
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+private:
+    void work()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cv.wait(lock, [this](){ return _stop || !_tasks.empty(); });
+                if (_stop && _tasks.empty())
+                {
+                    return;
+                }
+                task = std::move(_tasks.front());
+                _tasks.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> _workers;
+    std::queue<std::function<void()>> _tasks;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _stop{false};
+};
+
+#endif // THREADPOOL_H
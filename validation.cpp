@@ -0,0 +1,128 @@
+#include "validation.h"
+#include "instrument.h"
+#include "threadpool.h"
+
+#include <cmath>
+
+namespace {
+
+double predictRow(const Dataset &data, const size_t row, const std::vector<double> &par)
+{
+    auto res{par.back()};
+    for (size_t e{0}; e < data.elements.size(); ++e)
+    {
+        res += par[e] * data.values[e][row];
+    }
+    return res;
+}
+
+}
+
+void CrossValidation::print(const Dataset &data) const
+{
+    std::cout << "cross-validation: " << folds.size() << " folds, rmse = " << rmse << std::endl;
+    for (size_t i{0}; i < folds.size(); ++i)
+    {
+        std::cout << "fold " << i << ": n = " << folds[i].n << " rmse = " << folds[i].rmse << " [";
+        for (auto s : folds[i].samples)
+        {
+            std::cout << " " << data.samples[s];
+        }
+        std::cout << " ]" << std::endl;
+    }
+    for (size_t s{0}; s < sampleN.size(); ++s)
+    {
+        if (sampleN[s] > 0)
+        {
+            std::cout << data.samples[s] << ": n = " << sampleN[s] << " rmse = " << sampleRmse[s] << std::endl;
+        }
+    }
+}
+
+CrossValidation crossValidate(const Dataset &data,
+                              const Data1::Value value,
+                              const size_t nFolds,
+                              const std::map<size_t, ParLimits> &limits,
+                              const double yErr,
+                              const unsigned int nThreads)
+{
+    if (nFolds == 1)
+    {
+        throw my_error("crossValidate: at least 2 folds are needed, one fold leaves nothing to train on");
+    }
+    StageTimer timer("cv");
+    const auto rows{data.rowsWith(value)};
+    std::vector<size_t> samples;
+    for (auto row : rows)
+    {
+        if (samples.empty() || samples.back() != data.rowSample[row])
+        {
+            samples.push_back(data.rowSample[row]);
+        }
+    }
+    if (samples.size() < 2)
+    {
+        throw my_error("crossValidate: at least two samples are needed");
+    }
+    const auto k{nFolds == 0 ? samples.size() : std::min(nFolds, samples.size())};
+
+    CrossValidation cv;
+    cv.folds.resize(k);
+    std::vector<size_t> sampleFold(data.samples.size(), k);
+    for (size_t i{0}; i < samples.size(); ++i)
+    {
+        sampleFold[samples[i]] = i % k;
+        cv.folds[i % k].samples.push_back(samples[i]);
+    }
+
+    cv.prediction.assign(rows.size(), 0.0);
+    const auto w{1.0 / (yErr * yErr)};
+    const auto nThreadsUsed{std::min<unsigned int>(defaultThreads(nThreads), static_cast<unsigned int>(k))};
+    ThreadPool pool(nThreadsUsed - 1);
+    pool.parallelFor(k, [&](size_t fold){
+        std::vector<size_t> train;
+        std::vector<double> y;
+        for (auto row : rows)
+        {
+            if (sampleFold[data.rowSample[row]] != fold)
+            {
+                train.push_back(row);
+                y.push_back(data.reference(row, value).value());
+            }
+        }
+        auto &result{cv.folds[fold]};
+        result.fit = fitLinear(data.design(train), y, std::vector<double>(train.size(), w), limits);
+        auto sum2{0.0};
+        for (size_t i{0}; i < rows.size(); ++i)
+        {
+            if (sampleFold[data.rowSample[rows[i]]] == fold)
+            {
+                cv.prediction[i] = predictRow(data, rows[i], result.fit.par);
+                auto d{cv.prediction[i] - data.reference(rows[i], value).value()};
+                sum2 += d * d;
+                ++result.n;
+            }
+        }
+        result.rmse = std::sqrt(sum2 / static_cast<double>(result.n));
+    });
+
+    cv.sampleN.assign(data.samples.size(), 0);
+    cv.sampleRmse.assign(data.samples.size(), 0.0);
+    auto sum2{0.0};
+    for (size_t i{0}; i < rows.size(); ++i)
+    {
+        auto d{cv.prediction[i] - data.reference(rows[i], value).value()};
+        sum2 += d * d;
+        ++cv.sampleN[data.rowSample[rows[i]]];
+        cv.sampleRmse[data.rowSample[rows[i]]] += d * d;
+    }
+    for (size_t s{0}; s < cv.sampleN.size(); ++s)
+    {
+        if (cv.sampleN[s] > 0)
+        {
+            cv.sampleRmse[s] = std::sqrt(cv.sampleRmse[s] / static_cast<double>(cv.sampleN[s]));
+        }
+    }
+    cv.rmse = std::sqrt(sum2 / static_cast<double>(rows.size()));
+    return cv;
+}
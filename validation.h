@@ -0,0 +1,35 @@
+#ifndef VALIDATION_H
+#define VALIDATION_H
+
+#include "dataset.h"
+#include "lsq.h"
+
+struct FoldResult {
+    std::vector<size_t> samples; // held-out sample indices
+    LinearFit fit;
+    size_t n{0};
+    double rmse{0.0};
+};
+
+struct CrossValidation {
+    std::vector<FoldResult> folds;
+    std::vector<size_t> sampleN;    // held-out rows per sample
+    std::vector<double> sampleRmse; // per sample
+    std::vector<double> prediction; // out-of-fold prediction of every fitted row, in row order
+    double rmse{0.0};               // pooled over all rows
+    void print(const Dataset &data) const;
+};
+
+// Refits the calibration of value without each fold and predicts the held-out rows.
+// Folds are built from whole samples, so replicates of a sample never sit on both sides.
+// nFolds == 0 means leave one sample out, otherwise samples are dealt to nFolds folds in key order,
+// nFolds == 1 throws my_error.
+// Fit settings are those of the full calibration: limits and a common yErr of the reference values.
+CrossValidation crossValidate(const Dataset &data,
+                              const Data1::Value value,
+                              const size_t nFolds,
+                              const std::map<size_t, ParLimits> &limits,
+                              const double yErr,
+                              const unsigned int nThreads = 0);
+
+#endif // VALIDATION_H